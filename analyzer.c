@@ -0,0 +1,560 @@
+#include "analyzer.h"
+#include "filter.h"
+#include "spectrum.h"
+#include "timing.h"
+#include "util.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+int
+an_valid_fft_size(int fft_size)
+{
+    return fft_size >= MIN_FFT_SIZE && fft_size <= MAX_FFT_SIZE &&
+           (fft_size & (fft_size - 1)) == 0;
+}
+
+int
+an_valid_sample_rate(int sample_rate)
+{
+    return sample_rate >= MIN_SAMPLE_RATE && sample_rate <= MAX_SAMPLE_RATE;
+}
+
+int
+an_init(analyzer* an, int sample_rate, int fft_size)
+{
+    an->amp_scalar = 5000;
+    an->filter_mode = DoubleBoxFilter;
+    an->filter_range = 2;
+    an->alpha = 0.2;
+    an->attack_ms = DEFAULT_ATTACK_MS;
+    an->release_ms = DEFAULT_RELEASE_MS;
+    an->peak_hold_ms = 0;
+    an->peak_fall_ms = DEFAULT_PEAK_FALL_MS;
+    an->hop = DEFAULT_HOP_SIZE;
+    an->window = WindowHanning;
+    an->format = SampleU8;
+    an->channels = 1;
+    an->stereo = StereoMid;
+    an->layout = BandLog;
+    an->bands = DEFAULT_BANDS;
+    an->octave_fraction = DEFAULT_OCTAVE_FRACTION;
+
+    an->sample_rate = 0;
+    an->fft_size = 0;
+    an->freq_count = 0;
+    an->map = (band_map){ 0 };
+    an->sparse = 0;
+    an->goertzel = (goertzel_bank){ 0 };
+    an->samples = NULL;
+    an->frames = NULL;
+    for (int c = 0; c < MAX_CHANNELS; c++)
+        an->st[c] = (stft){ 0 };
+    an->plan = NULL;
+    an->fft_path = DEFAULT_FFT_PATH;
+    an->q15 = (q15_fft){ 0 };
+    an->sliding = (sdft){ 0 };
+    an->fft_tmp = NULL;
+    an->power = NULL;
+    an->tilt = NULL;
+    an->spectrum_ns = 0;
+    an->filter_ns = 0;
+    an->onset = 0;
+
+    an->fft = calloc(MAX_CHANNELS * MAX_BANDS, sizeof(float));
+    an->peaks = calloc(MAX_CHANNELS * MAX_BANDS, sizeof(float));
+    an->peak_ages = calloc(MAX_CHANNELS * MAX_BANDS, sizeof(float));
+    an->levels = malloc(MAX_BANDS * sizeof(float));
+    an->filter_tmp = malloc(MAX_BANDS * sizeof(float));
+    an->filter_sums = malloc(FILTER_SUMS_SIZE(MAX_BANDS) * sizeof(double));
+
+    int detector_failed = onset_init(&an->detector);
+
+    if (!an->fft || !an->peaks || !an->peak_ages || !an->levels ||
+        !an->filter_tmp || !an->filter_sums || detector_failed ||
+        an_resize(an, sample_rate, fft_size)) {
+        an_free(an);
+        return 1;
+    }
+
+    return 0;
+}
+
+// frees the buffers that depend on the fft size
+static void
+free_format(analyzer* an)
+{
+    free(an->samples);
+    free(an->frames);
+    for (int c = 0; c < MAX_CHANNELS; c++)
+        stft_free(&an->st[c]);
+    fft_plan_destroy(an->plan);
+    q15_free(&an->q15);
+    free(an->fft_tmp);
+    free(an->power);
+    free(an->tilt);
+
+    an->samples = NULL;
+    an->frames = NULL;
+    an->plan = NULL;
+    an->fft_tmp = NULL;
+    an->power = NULL;
+    an->tilt = NULL;
+    an->fft_size = 0;
+}
+
+// the bands and their peaks back to silence, the rise out of it is no
+// onset
+static void
+clear_bands(analyzer* an)
+{
+    memset(an->fft, 0, MAX_CHANNELS * MAX_BANDS * sizeof(float));
+    memset(an->peaks, 0, MAX_CHANNELS * MAX_BANDS * sizeof(float));
+    memset(an->peak_ages, 0, MAX_CHANNELS * MAX_BANDS * sizeof(float));
+    onset_reset(&an->detector);
+}
+
+// the map of a layout, the list one has a band per frequency
+static int
+build_map(analyzer* an,
+          band_map* map,
+          band_layout layout,
+          int bands,
+          int octave_fraction,
+          int sample_rate,
+          int fft_size)
+{
+    if (layout == BandList)
+        bands = an->freq_count;
+
+    return bands_build(map,
+                       layout,
+                       bands,
+                       octave_fraction,
+                       sample_rate,
+                       fft_size,
+                       an->freqs);
+}
+
+// swaps in a freshly built map, the old bands no longer line up with it,
+// and the goertzel bank of its bins if that is cheaper, without one the
+// rfft does, and the sliding dft of them if that is the path
+static void
+use_map(analyzer* an, band_map* map)
+{
+    bands_free(&an->map);
+    an->map = *map;
+
+    goertzel_free(&an->goertzel);
+    an->sparse = goertzel_cheaper(&an->map, an->fft_size) &&
+                 !goertzel_init(&an->goertzel, &an->map, an->fft_size);
+
+    sdft_free(&an->sliding);
+    if (an->fft_path == FftSliding)
+        sdft_init(&an->sliding, &an->map, an->fft_size);
+
+    clear_bands(an);
+}
+
+int
+an_resize(analyzer* an, int sample_rate, int fft_size)
+{
+    if (!an_valid_sample_rate(sample_rate) || !an_valid_fft_size(fft_size))
+        return 1;
+
+    band_map map = { 0 };
+    if (build_map(an,
+                  &map,
+                  an->layout,
+                  an->bands,
+                  an->octave_fraction,
+                  sample_rate,
+                  fft_size))
+        return 1;
+
+    if (fft_size == an->fft_size) {
+        an->sample_rate = sample_rate;
+        use_map(an, &map);
+        return 0;
+    }
+
+    stft st[MAX_CHANNELS] = { { 0 } };
+    int st_failed = 0;
+    for (int c = 0; c < MAX_CHANNELS; c++)
+        st_failed |= stft_init(&st[c], fft_size, an->window);
+
+    int n = MAX_CHANNELS * fft_size;
+    void* samples = malloc(n * MAX_SAMPLE_SIZE);
+    float* frames = malloc(n * sizeof(float));
+    fft_plan* plan = fft_plan_create(fft_size / 2);
+    float* fft_tmp = malloc(n * sizeof(float));
+    float* power = malloc(fft_size / 2 * sizeof(float));
+    float* tilt = malloc(fft_size * sizeof(float));
+
+    q15_fft q15 = { 0 };
+    int q15_failed = !plan || q15_init(&q15, plan);
+
+    if (st_failed || !samples || !frames || !plan || q15_failed ||
+        !fft_tmp || !power || !tilt) {
+        free(samples);
+        free(frames);
+        fft_plan_destroy(plan);
+        q15_free(&q15);
+        free(fft_tmp);
+        free(power);
+        free(tilt);
+        for (int c = 0; c < MAX_CHANNELS; c++)
+            stft_free(&st[c]);
+        bands_free(&map);
+        return 1;
+    }
+
+    free_format(an);
+
+    an->sample_rate = sample_rate;
+    an->fft_size = fft_size;
+    an->samples = samples;
+    an->frames = frames;
+    for (int c = 0; c < MAX_CHANNELS; c++)
+        an->st[c] = st[c];
+    an->plan = plan;
+    an->q15 = q15;
+    an->fft_tmp = fft_tmp;
+    an->power = power;
+    an->tilt = tilt;
+    an->hop = min(an->hop, fft_size);
+
+    spectrum_make_tilt(an->tilt, fft_size);
+    use_map(an, &map);
+
+    return 0;
+}
+
+int
+an_set_bands(analyzer* an,
+             band_layout layout,
+             int bands,
+             int octave_fraction)
+{
+    band_map map = { 0 };
+    if (build_map(an,
+                  &map,
+                  layout,
+                  bands,
+                  octave_fraction,
+                  an->sample_rate,
+                  an->fft_size))
+        return 1;
+
+    an->layout = layout;
+    an->bands = bands;
+    an->octave_fraction = octave_fraction;
+    use_map(an, &map);
+
+    return 0;
+}
+
+const char* stereo_mode_names[STEREO_MODES] = { "mid", "side", "split" };
+
+const char*
+stereo_mode_name(stereo_mode mode)
+{
+    return stereo_mode_names[mode];
+}
+
+const char* fft_path_names[FFT_PATHS] = { "float", "q15", "sdft" };
+
+const char*
+fft_path_name(fft_path path)
+{
+    return fft_path_names[path];
+}
+
+int
+an_set_fft_path(analyzer* an, fft_path path)
+{
+    // the q15 path feeds only its own history and the others only the
+    // float one, so the one taken over holds samples from before the
+    // switch; the sliding dft anchors on the silence on its first update
+    if (path != an->fft_path) {
+        for (int c = 0; c < MAX_CHANNELS; c++)
+            stft_clear(&an->st[c]);
+        q15_clear(&an->q15);
+    }
+
+    an->fft_path = path;
+
+    sdft_free(&an->sliding);
+    if (path == FftSliding)
+        return sdft_init(&an->sliding, &an->map, an->fft_size);
+
+    return 0;
+}
+
+fft_path
+an_active_path(const analyzer* an)
+{
+    if (an->fft_path == FftQ15 && an->format != SampleF32)
+        return FftQ15;
+
+    if (an->fft_path == FftSliding && an->sliding.bins)
+        return FftSliding;
+
+    return FftFloat;
+}
+
+void
+an_set_stereo(analyzer* an, stereo_mode mode)
+{
+    an->stereo = mode;
+    clear_bands(an);
+}
+
+int
+an_spectra(const analyzer* an)
+{
+    return an->channels == 2 && an->stereo == StereoSplit ? 2 : 1;
+}
+
+void
+an_free(analyzer* an)
+{
+    free_format(an);
+    bands_free(&an->map);
+    goertzel_free(&an->goertzel);
+    sdft_free(&an->sliding);
+
+    onset_free(&an->detector);
+
+    free(an->fft);
+    free(an->peaks);
+    free(an->peak_ages);
+    free(an->levels);
+    free(an->filter_tmp);
+    free(an->filter_sums);
+
+    an->fft = NULL;
+    an->peaks = NULL;
+    an->peak_ages = NULL;
+    an->levels = NULL;
+    an->filter_tmp = NULL;
+    an->filter_sums = NULL;
+}
+
+// filters the n bands of one spectrum
+static void
+filter_fft(analyzer* an, float* fft)
+{
+    int n = an->map.count;
+
+    switch (an->filter_mode) {
+        case Block:
+            apply_block_filter(fft, n, an->filter_range);
+            break;
+        case BoxFilter:
+            apply_box_filter(fft, an->filter_sums, n, an->filter_range);
+            break;
+        case DoubleBoxFilter:
+            apply_box_filter(fft, an->filter_sums, n, an->filter_range);
+            apply_box_filter(fft, an->filter_sums, n, an->filter_range);
+            break;
+        case WeightedFilter:
+            apply_weighted_filter(fft, an->filter_sums, n, an->filter_range);
+            break;
+        case ExponentialFilter:
+            apply_exponential_smoothing(fft, an->filter_tmp, n, an->alpha);
+            break;
+    }
+}
+
+// the part of the distance to the new value a band keeps per frame of dt
+// seconds, for a time constant of ms, 0 moves at once
+static float
+ballistic(float ms, float dt)
+{
+    return ms > 0 ? expf(-dt * 1000 / ms) : 0.0f;
+}
+
+// the hop of integer samples to the q15 history of each spectrum
+static void
+push_q15(analyzer* an, int hop)
+{
+    q15_fft* q = &an->q15;
+    const short* x = an->samples;
+
+    if (an->format == SampleU8) {
+        q15_ingest_u8(q->frames, an->samples, hop * an->channels);
+        x = q->frames;
+    }
+
+    if (an->channels == 1) {
+        q15_push(q, 0, x, hop);
+    } else if (an_spectra(an) == 2) {
+        q15_split(q->planes, q->planes + q->size, x, hop);
+        q15_push(q, 0, q->planes, hop);
+        q15_push(q, 1, q->planes + q->size, hop);
+    } else {
+        q15_mix(q->planes, x, hop, an->stereo == StereoSide ? -1 : 1);
+        q15_push(q, 0, q->planes, hop);
+    }
+}
+
+// the pipeline for n = fft_size, inlined per common size so the loops run
+// with a constant trip count
+static inline __attribute__((always_inline)) void
+process(analyzer* an, int n)
+{
+    // tmp storage of fft on samples, a plane of n per spectrum
+    float* fft_tmp = an->fft_tmp;
+    int hop = an->hop;
+    int channels = an->channels;
+    int spectra = an_spectra(an);
+    int count = an->map.count;
+
+    long long spectrum_start = time_now_ns();
+
+    // u8 samples are shifted by 256/2 to the left so we get a 0 when there
+    // is no sound at that time, instead of a 128
+    //
+    // and also scale the amps a bit for better visualization
+    float gain = (float)an->amp_scalar;
+
+    // the q15 path keeps the integers and applies the gain to the powers
+    fft_path path = an_active_path(an);
+    int fixed = path == FftQ15;
+
+    // mono goes straight to its plane, stereo is split or mixed after
+    float* x = channels == 1 ? fft_tmp : an->frames;
+
+    if (fixed)
+        push_q15(an, hop);
+    else if (an->format == SampleS16)
+        spectrum_ingest_s16(x, an->samples, hop * channels, gain);
+    else if (an->format == SampleF32)
+        spectrum_ingest_f32(x, an->samples, hop * channels, gain);
+    else
+        spectrum_ingest_u8(x, an->samples, hop * channels, gain);
+
+    if (channels == 2 && !fixed) {
+        if (spectra == 2)
+            spectrum_split(fft_tmp, fft_tmp + n, x, hop);
+        else
+            spectrum_mix(
+              fft_tmp, x, hop, an->stereo == StereoSide ? -1.0f : 1.0f);
+    }
+
+    // the ballistics run on stream time, a frame covers hop samples
+    // whatever the fft size or the rate frames are drawn at
+    float dt = (float)hop / an->sample_rate;
+    float attack = ballistic(an->attack_ms, dt);
+    float release = ballistic(an->release_ms, dt);
+
+    // the summed rise of the bands of all spectra
+    float flux = 0;
+
+    // rfft returns only the positive half, n / 2 complex bins, of which
+    // only the ones under some band are needed
+    int start = an->map.bin_start;
+    int bins = an->map.bin_end - start;
+
+    for (int c = 0; c < spectra; c++) {
+        float* plane = fft_tmp + c * n;
+
+        stft_set_window(&an->st[c], an->window);
+
+        if (fixed) {
+            q15_fft* q = &an->q15;
+
+            q15_set_window(q, &an->st[c]);
+            q15_rfft(q, c);
+
+            // remove dc component
+            q->out[0] = q->out[2];
+
+            q15_power(q->out + 2 * start,
+                      an->tilt + 2 * start,
+                      an->power + start,
+                      bins,
+                      q15_scale(q, gain));
+        } else if (path == FftSliding) {
+            // the bins move with the samples leaving the history, so
+            // before the push
+            sdft_update(
+              &an->sliding, c, an->st[c].ring + an->st[c].pos, plane, hop);
+            stft_push(&an->st[c], plane, hop);
+
+            sdft_power(&an->sliding, c, an->window, an->tilt, an->power);
+        } else {
+            stft_push(&an->st[c], plane, hop);
+            stft_frame(&an->st[c], plane);
+
+            if (an->sparse) {
+                // only the bins the bands read
+                goertzel_power(&an->goertzel, plane, n, an->tilt, an->power);
+            } else {
+                // run the fft
+                rfft_plan(an->plan, plane, FFT_FORWARD);
+
+                // remove dc component
+                plane[0] = plane[2];
+
+                spectrum_power(plane + 2 * start,
+                               an->tilt + 2 * start,
+                               an->power + start,
+                               bins);
+            }
+        }
+
+        // sum the bin powers into bands, everything after this scales with
+        // the number of bands
+        bands_apply(&an->map, an->power, an->levels);
+        spectrum_post(
+          an->levels, an->fft + c * count, count, attack, release);
+        flux += spectrum_sum(an->levels, count);
+    }
+
+    // per band, so the threshold does not depend on the band count
+    an->onset = onset_update(&an->detector, flux / (spectra * count), dt);
+
+    long long filter_start = time_now_ns();
+
+    // apply an averaging filter
+    for (int c = 0; c < spectra; c++)
+        filter_fft(an, an->fft + c * count);
+
+    // the peaks of what is shown, so after the filters
+    if (an->peak_hold_ms > 0)
+        spectrum_peaks(an->fft,
+                       an->peaks,
+                       an->peak_ages,
+                       spectra * count,
+                       dt,
+                       an->peak_hold_ms / 1000.0f,
+                       an->peak_fall_ms > 0 ? dt * 1000 / an->peak_fall_ms
+                                            : 1.0f);
+
+    an->spectrum_ns = filter_start - spectrum_start;
+    an->filter_ns = time_now_ns() - filter_start;
+}
+
+void
+an_process(analyzer* an)
+{
+    switch (an->fft_size) {
+        case 256:
+            process(an, 256);
+            break;
+        case 512:
+            process(an, 512);
+            break;
+        case 1024:
+            process(an, 1024);
+            break;
+        case 2048:
+            process(an, 2048);
+            break;
+        default:
+            process(an, an->fft_size);
+            break;
+    }
+}
@@ -0,0 +1,268 @@
+#ifndef ANALYZER
+#define ANALYZER
+
+#include "bands.h"
+#include "chuck_fft.h"
+#include "fft_q15.h"
+#include "goertzel.h"
+#include "onset.h"
+#include "sdft.h"
+#include "spectrum.h"
+#include "stft.h"
+
+#define DEFAULT_SAMPLE_RATE 10000
+#define DEFAULT_FFT_SIZE 256 // Number of samples
+#define DEFAULT_HOP_SIZE 64  // new samples per analysis frame
+
+// instant rise, and the fall of the old 80% per 256 samples at 10 kHz
+#define DEFAULT_ATTACK_MS 0
+#define DEFAULT_RELEASE_MS 115
+#define DEFAULT_PEAK_FALL_MS 1000
+
+// the longest attack, release, peak hold and peak fall, a minute
+#define MAX_BALLISTICS_MS 60000
+
+#define MIN_SAMPLE_RATE 1000
+#define MAX_SAMPLE_RATE 192000
+#define MIN_FFT_SIZE 16
+#define MAX_FFT_SIZE 65536
+
+typedef enum filter_type
+{
+    // groups the frequencies as filter_range blocks
+    // as the amp being the avg value of the frequencies
+    // in that block
+    Block = 1,
+
+    // smooths out amps as it takes the average value
+    // of the neighboring frequencies amps and makes it
+    // the result value of each frequency
+    BoxFilter = 2,
+
+    // runs box filter twice
+    DoubleBoxFilter = 3,
+
+    // box filter, the only difference being that
+    // more distant frequencies from each frequency
+    // contribute less to the avarage
+    WeightedFilter = 4,
+
+    // smooths out the fft as it uses the `alpha` value
+    // to control how much the neighboring (left/right)
+    // frequencies contribute to the smoothing
+    ExponentialFilter = 5
+} filter_type;
+
+// what a stereo capture is shown as
+typedef enum stereo_mode
+{
+    // (l + r) / 2, what a mono capture always is
+    StereoMid = 0,
+
+    // (l - r) / 2, what differs between the channels
+    StereoSide = 1,
+
+    // a spectrum per channel, left then right
+    StereoSplit = 2
+} stereo_mode;
+
+#define STEREO_MODES 3
+
+// how the samples get to the bin powers
+typedef enum fft_path
+{
+    // samples to float, then the float rfft
+    FftFloat = 0,
+
+    // u8 / s16 samples through the q15 rfft, float samples keep the float
+    // one
+    FftQ15 = 1,
+
+    // float samples slid through the dft bins the bands read one at a
+    // time, for small hops
+    FftSliding = 2
+} fft_path;
+
+#define FFT_PATHS 3
+
+// the path an_init() starts with, build with FFT=q15 for boxes without a
+// fast fpu
+#ifndef DEFAULT_FFT_PATH
+#define DEFAULT_FFT_PATH FftFloat
+#endif
+
+// turns captured samples into display bands
+typedef struct analyzer
+{
+    int sample_rate;
+
+    // samples per fft
+    int fft_size;
+
+    // new samples per frame, 1..fft_size, the frames overlap by
+    // fft_size - hop samples
+    int hop;
+
+    window_type window;
+
+    // sample amplitude scalar
+    int amp_scalar;
+
+    filter_type filter_mode;
+
+    // block size, box / weighted filter range, in bands
+    int filter_range;
+
+    // used in ExponentialFilter
+    float alpha;
+
+    // time constants of a band rising and falling toward a new value, in
+    // ms of stream time, 0 for an instant one
+    float attack_ms;
+    float release_ms;
+
+    // peak markers: how long a peak holds once its band falls, 0 for no
+    // peaks, and how long it then takes to fall from full scale to 0
+    float peak_hold_ms;
+    float peak_fall_ms;
+
+    // requested band layout, count and 1/N octave fraction, the built
+    // count is in map.count
+    band_layout layout;
+    int bands;
+    int octave_fraction;
+
+    // the frequencies of the list layout, in Hz
+    float freqs[MAX_BAND_FREQS];
+    int freq_count;
+
+    // fft bins to display bands
+    band_map map;
+
+    // 1 while the map reads few enough bins that a goertzel bank of them
+    // is cheaper than the float rfft, which it then replaces
+    int sparse;
+    goertzel_bank goertzel;
+
+    stereo_mode stereo;
+
+    // display bands, map.count values per spectrum, allocated for
+    // MAX_CHANNELS spectra
+    float* fft;
+
+    // the peak of each band and the seconds since it was set, like fft
+    float* peaks;
+    float* peak_ages;
+
+    // onsets in the rise of all bands, and 1 if the last frame was one
+    onset_detector detector;
+    int onset;
+
+    // capture buffer, up to fft_size frames of `channels` samples of
+    // `format`
+    sample_format format;
+    int channels;
+    void* samples;
+
+    // the hop as interleaved floats, MAX_CHANNELS * fft_size values
+    float* frames;
+
+    // history of the last fft_size samples of each spectrum
+    stft st[MAX_CHANNELS];
+
+    // tables for the rfft of fft_size samples
+    fft_plan* plan;
+
+    fft_path fft_path;
+
+    // the fixed point rfft of fft_size samples, with its own history
+    q15_fft q15;
+
+    // the sliding dft of the bins the map reads, built while fft_path is
+    // FftSliding, on the history of st
+    sdft sliding;
+
+    // fft input / output, fft_size values per spectrum
+    float* fft_tmp;
+
+    // power per fft bin, fft_size / 2 values
+    float* power;
+
+    // the band buffers are allocated for MAX_BANDS so changing the bands
+    // only rebuilds the map
+    //
+    // power per band, filter scratch
+    float* levels;
+    float* filter_tmp;
+
+    // running sums of the box / weighted filters
+    double* filter_sums;
+
+    // per float scaling of the rfft output, fft_size values
+    float* tilt;
+
+    // monotonic ns spent in the last frame from the samples to the bands,
+    // and in the filters
+    long long spectrum_ns;
+    long long filter_ns;
+} analyzer;
+
+// 1 if fft_size is a supported power of 2
+int
+an_valid_fft_size(int fft_size);
+
+int
+an_valid_sample_rate(int sample_rate);
+
+// sets the default settings and allocates the buffers
+// returns 1 on failure
+int
+an_init(analyzer* an, int sample_rate, int fft_size);
+
+// reallocates the buffers and rebuilds the band map for a new format, the
+// bands start from silence and the hop is clamped to the new fft size
+// returns 1 on failure, leaving the old format in place
+int
+an_resize(analyzer* an, int sample_rate, int fft_size);
+
+// rebuilds the band map with the new layout / count, the bands start from
+// silence
+// returns 1 on failure, leaving the old bands in place
+int
+an_set_bands(analyzer* an, band_layout layout, int bands, int octave_fraction);
+
+// switches what a stereo capture is shown as, the bands start from
+// silence
+void
+an_set_stereo(analyzer* an, stereo_mode mode);
+
+const char*
+stereo_mode_name(stereo_mode mode);
+
+const char*
+fft_path_name(fft_path path);
+
+// switches how the samples get to the bin powers
+// returns 1 on failure, the frames then take the float rfft
+int
+an_set_fft_path(analyzer* an, fft_path path);
+
+// the path the frames go through: fft_path unless the q15 one gets float
+// samples or the sliding dft could not be built, which take the float one
+fft_path
+an_active_path(const analyzer* an);
+
+// spectra in an->fft per frame, 2 for split stereo, 1 otherwise
+int
+an_spectra(const analyzer* an);
+
+void
+an_free(analyzer* an);
+
+// appends hop frames of an->format from an->samples to the history, runs
+// the fft on the windowed history of each spectrum, maps it to bands and
+// updates an->fft
+void
+an_process(analyzer* an);
+
+#endif
@@ -0,0 +1,254 @@
+#include "bands.h"
+#include <math.h>
+#include <stdlib.h>
+
+const char*
+band_layout_name(band_layout layout)
+{
+    switch (layout) {
+        case BandLog:
+            return "log";
+        case BandMel:
+            return "mel";
+        case BandOctave:
+            return "octave";
+        case BandList:
+            return "list";
+        default:
+            return "linear";
+    }
+}
+
+static double
+hz_to_mel(double f)
+{
+    return 2595.0 * log10(1.0 + f / 700.0);
+}
+
+static double
+mel_to_hz(double m)
+{
+    return 700.0 * (pow(10.0, m / 2595.0) - 1.0);
+}
+
+// fills edges[0..count] for the layout, returns the band count
+// (edges == NULL only counts), the list layout has a band of a bin around
+// each frequency instead
+static int
+band_edges(double* edges,
+           band_layout layout,
+           int count,
+           int octave_fraction,
+           double fmin,
+           double fmax)
+{
+    switch (layout) {
+        case BandLog:
+        case BandMel:
+            if (edges == NULL)
+                return count;
+
+            for (int b = 0; b <= count; b++) {
+                double t = (double)b / count;
+
+                if (layout == BandLog)
+                    edges[b] = fmin * pow(fmax / fmin, t);
+                else
+                    edges[b] = mel_to_hz(
+                      hz_to_mel(fmin) +
+                      (hz_to_mel(fmax) - hz_to_mel(fmin)) * t);
+            }
+            return count;
+
+        case BandOctave: {
+            // centers at 1 kHz * 2^(k / N), edges half a step around them
+            double n = octave_fraction;
+            int kmin = (int)ceil(n * log2(fmin / 1000.0) + 0.5);
+            int kmax = (int)floor(n * log2(fmax / 1000.0) - 0.5);
+
+            int bands = kmax - kmin + 1;
+            if (bands > MAX_BANDS)
+                bands = MAX_BANDS;
+            if (bands < 1)
+                return 0;
+
+            if (edges != NULL) {
+                for (int b = 0; b <= bands; b++)
+                    edges[b] = 1000.0 * pow(2.0, (kmin + b - 0.5) / n);
+            }
+            return bands;
+        }
+
+        default:
+            if (edges == NULL)
+                return count;
+
+            for (int b = 0; b <= count; b++)
+                edges[b] = (fmax / count) * b;
+            return count;
+    }
+}
+
+int
+bands_build(band_map* bm,
+            band_layout layout,
+            int count,
+            int octave_fraction,
+            int sample_rate,
+            int fft_size,
+            const float* freqs)
+{
+    int bins = fft_size / 2;
+    double df = (double)sample_rate / fft_size;
+
+    // bin k covers (k - 1/2) df .. (k + 1/2) df
+    double fmin = BANDS_MIN_FREQ < df / 2 ? df / 2 : BANDS_MIN_FREQ;
+    double fmax = (bins - 0.5) * df;
+
+    if (count < 1 || count > MAX_BANDS || octave_fraction < 1)
+        return 1;
+
+    if (layout == BandList && (freqs == NULL || count > MAX_BAND_FREQS))
+        return 1;
+
+    count = band_edges(NULL, layout, count, octave_fraction, fmin, fmax);
+    if (count < 1)
+        return 1;
+
+    double* edges = malloc((count + 1) * sizeof(double));
+    int* first = malloc(count * sizeof(int));
+    int* len = malloc(count * sizeof(int));
+    int* offset = malloc(count * sizeof(int));
+
+    if (!edges || !first || !len || !offset) {
+        free(edges);
+        free(first);
+        free(len);
+        free(offset);
+        return 1;
+    }
+
+    // a list band covers its bin, past dc which the rfft replaces
+    if (layout == BandList) {
+        for (int b = 0; b < count; b++) {
+            int k = (int)floor(freqs[b] / df + 0.5);
+            k = k < 1 ? 1 : (k > bins - 1 ? bins - 1 : k);
+            first[b] = k;
+        }
+    } else {
+        band_edges(edges, layout, count, octave_fraction, fmin, fmax);
+    }
+
+    int nnz = 0;
+    for (int b = 0; b < count; b++) {
+        if (layout == BandList) {
+            len[b] = 1;
+            offset[b] = nnz++;
+            continue;
+        }
+
+        int lo = (int)floor(edges[b] / df + 0.5);
+        int hi = (int)floor(edges[b + 1] / df + 0.5);
+
+        lo = lo < 0 ? 0 : (lo > bins - 1 ? bins - 1 : lo);
+        hi = hi < lo ? lo : (hi > bins - 1 ? bins - 1 : hi);
+
+        first[b] = lo;
+        len[b] = hi - lo + 1;
+        offset[b] = nnz;
+        nnz += len[b];
+    }
+
+    float* weights = malloc(nnz * sizeof(float));
+    if (!weights) {
+        free(edges);
+        free(first);
+        free(len);
+        free(offset);
+        return 1;
+    }
+
+    for (int b = 0; b < count; b++) {
+        if (layout == BandList) {
+            weights[offset[b]] = 1.0f;
+            continue;
+        }
+
+        double lo = edges[b];
+        double hi = edges[b + 1];
+        double sum = 0;
+
+        for (int j = 0; j < len[b]; j++) {
+            int k = first[b] + j;
+            double start = (k - 0.5) * df;
+            double end = (k + 0.5) * df;
+
+            double overlap = (hi < end ? hi : end) - (lo > start ? lo : start);
+            if (overlap < 0)
+                overlap = 0;
+
+            weights[offset[b] + j] = (float)overlap;
+            sum += overlap;
+        }
+
+        // a band narrower than rounding allows falls back to the bin at
+        // its edge
+        for (int j = 0; j < len[b]; j++) {
+            if (sum > 0)
+                weights[offset[b] + j] /= (float)sum;
+            else
+                weights[offset[b] + j] = j == 0 ? 1.0f : 0.0f;
+        }
+    }
+
+    free(edges);
+    bands_free(bm);
+
+    bm->layout = layout;
+    bm->count = count;
+    bm->first = first;
+    bm->len = len;
+    bm->offset = offset;
+    bm->weights = weights;
+    // the list layout is in any order
+    bm->bin_start = first[0];
+    bm->bin_end = first[0] + len[0];
+    for (int b = 1; b < count; b++) {
+        if (first[b] < bm->bin_start)
+            bm->bin_start = first[b];
+        if (first[b] + len[b] > bm->bin_end)
+            bm->bin_end = first[b] + len[b];
+    }
+
+    return 0;
+}
+
+void
+bands_free(band_map* bm)
+{
+    free(bm->first);
+    free(bm->len);
+    free(bm->offset);
+    free(bm->weights);
+
+    bm->first = NULL;
+    bm->len = NULL;
+    bm->offset = NULL;
+    bm->weights = NULL;
+    bm->count = 0;
+}
+
+void
+bands_apply(const band_map* bm, const float* in, float* out)
+{
+    for (int b = 0; b < bm->count; b++) {
+        const float* w = bm->weights + bm->offset[b];
+        const float* x = in + bm->first[b];
+        float sum = 0;
+
+        for (int j = 0; j < bm->len[b]; j++)
+            sum += w[j] * x[j];
+
+        out[b] = sum;
+    }
+}
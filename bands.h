@@ -0,0 +1,80 @@
+#ifndef BANDS
+#define BANDS
+
+#define DEFAULT_BANDS 64
+#define MAX_BANDS 4096
+#define DEFAULT_OCTAVE_FRACTION 3
+
+// lowest frequency shown by the log, mel and octave layouts
+#define BANDS_MIN_FREQ 20.0f
+
+typedef enum band_layout
+{
+    // equal width bands from 0 to nyquist
+    BandLinear = 0,
+
+    // band edges evenly spaced on a log frequency axis
+    BandLog = 1,
+
+    // band edges evenly spaced on the mel scale
+    BandMel = 2,
+
+    // 1/N octave bands around 1 kHz, the count follows from N
+    BandOctave = 3,
+
+    // a band per listed frequency, the single bin nearest it
+    BandList = 4
+} band_layout;
+
+#define BAND_LAYOUTS 5
+
+// frequencies the list layout takes
+#define MAX_BAND_FREQS 256
+
+// sparse weights from fft bins to display bands
+//
+// band b is the weighted sum of bins first[b] .. first[b] + len[b] - 1
+// with the weights at weights[offset[b]..], the weights of a band sum to 1
+// (the share of the band each bin covers)
+typedef struct band_map
+{
+    band_layout layout;
+
+    // number of bands
+    int count;
+
+    int* first;
+    int* len;
+    int* offset;
+    float* weights;
+
+    // bins any band reads, bin_start .. bin_end - 1
+    int bin_start;
+    int bin_end;
+} band_map;
+
+const char*
+band_layout_name(band_layout layout);
+
+// builds the map of `count` bands (or 1/octave_fraction octave bands)
+// over the fft_size / 2 bins of an rfft at sample_rate, the list layout
+// has a band for each of the `count` frequencies in freqs, in Hz
+//
+// returns 1 on failure, leaving bm untouched
+int
+bands_build(band_map* bm,
+            band_layout layout,
+            int count,
+            int octave_fraction,
+            int sample_rate,
+            int fft_size,
+            const float* freqs);
+
+void
+bands_free(band_map* bm);
+
+// out[b] = sum of the band's weights * in[bin], in is indexed by bin
+void
+bands_apply(const band_map* bm, const float* in, float* out);
+
+#endif
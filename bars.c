@@ -0,0 +1,217 @@
+#include "bars.h"
+#include "raymath.h"
+#include "rlgl.h"
+#include "util.h"
+#include <stdlib.h>
+
+// floats of a bar, two triangles of x, y
+#define BAR_FLOATS 12
+
+const char* renderer_names[RENDERERS] = { "rects", "mesh" };
+
+const char*
+renderer_name(renderer r)
+{
+    return renderer_names[r];
+}
+
+void
+bars_span(int i, int count, int w, int* x, int* width)
+{
+    float bandWidth = (float)w / count;
+
+    int start_x = (int)(i * bandWidth);
+    int next_band_x = (int)((i + 1) * bandWidth);
+    int band_end = start_x + bandWidth;
+
+    *x = start_x;
+    *width = (band_end != next_band_x)
+               ? (int)(bandWidth) + (next_band_x - band_end)
+               : (int)(bandWidth);
+}
+
+void
+bars_init(bars* b)
+{
+    *b = (bars){ 0 };
+}
+
+// (re)creates the vertex buffer for capacity bars, the vertex array keeps
+// the position attribute pointing into it
+static int
+load_buffer(bars* b)
+{
+    if (b->vao == 0)
+        b->vao = rlLoadVertexArray();
+
+    if (b->vao == 0)
+        return 1;
+
+    rlEnableVertexArray(b->vao);
+
+    if (b->vbo != 0)
+        rlUnloadVertexBuffer(b->vbo);
+
+    b->vbo = rlLoadVertexBuffer(
+      b->verts, b->capacity * BAR_FLOATS * sizeof(float), true);
+
+    int loc = rlGetShaderLocsDefault()[SHADER_LOC_VERTEX_POSITION];
+    rlSetVertexAttribute(loc, 2, RL_FLOAT, false, 0, 0);
+    rlEnableVertexAttribute(loc);
+
+    rlDisableVertexArray();
+    return 0;
+}
+
+// vertices in the order DrawRectangle() emits its quad, top left, bottom
+// left, bottom right, top right, split along the same diagonal, the tops
+// are filled in per frame
+static int
+build(bars* b, int count, int top, int w, int h)
+{
+    if (count > b->capacity) {
+        float* verts = realloc(b->verts, count * BAR_FLOATS * sizeof(float));
+        if (verts == NULL)
+            return 1;
+
+        b->verts = verts;
+        b->capacity = count;
+
+        if (load_buffer(b))
+            return 1;
+    }
+
+    float bottom = top + h;
+
+    for (int i = 0; i < count; i++) {
+        int x, width;
+        bars_span(i, count, w, &x, &width);
+
+        float l = x;
+        float r = x + width;
+        float* v = b->verts + i * BAR_FLOATS;
+
+        v[0] = l, v[1] = bottom;
+        v[2] = l, v[3] = bottom;
+        v[4] = r, v[5] = bottom;
+        v[6] = l, v[7] = bottom;
+        v[8] = r, v[9] = bottom;
+        v[10] = r, v[11] = bottom;
+    }
+
+    b->count = count;
+    b->top = top;
+    b->width = w;
+    b->height = h;
+    return 0;
+}
+
+// the bars, or with thickness > 0 caps that thick at their tops
+static int
+draw(bars* b,
+     const float* values,
+     int count,
+     int top,
+     int w,
+     int h,
+     int thickness,
+     Color color)
+{
+    if (count != b->count || top != b->top || w != b->width ||
+        h != b->height)
+        if (build(b, count, top, w, h)) {
+            b->count = 0;
+            return 1;
+        }
+
+    // the tops, with the integer rounding of the rects
+    for (int i = 0; i < count; i++) {
+        int end_y = h - (h * values[i]);
+
+        if (end_y < 0)
+            end_y = 0;
+
+        if (end_y > h)
+            end_y = h;
+
+        float* v = b->verts + i * BAR_FLOATS;
+        v[1] = v[7] = v[11] = top + end_y;
+
+        if (thickness > 0)
+            v[3] = v[5] = v[9] = top + min(end_y + thickness, h);
+    }
+
+    // whatever is batched so far goes first, it is underneath
+    rlDrawRenderBatchActive();
+
+    rlUpdateVertexBuffer(
+      b->vbo, b->verts, count * BAR_FLOATS * sizeof(float), 0);
+
+    int* locs = rlGetShaderLocsDefault();
+    float white[4] = { 1, 1, 1, 1 };
+    float rgba[4] = {
+        color.r / 255.0f,
+        color.g / 255.0f,
+        color.b / 255.0f,
+        color.a / 255.0f,
+    };
+
+    rlEnableShader(rlGetShaderIdDefault());
+    rlSetUniformMatrix(
+      locs[SHADER_LOC_MATRIX_MVP],
+      MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection()));
+    rlSetUniform(locs[SHADER_LOC_COLOR_DIFFUSE], white, SHADER_UNIFORM_VEC4, 1);
+
+    // no color array, every vertex gets the bar color
+    rlSetVertexAttributeDefault(
+      locs[SHADER_LOC_VERTEX_COLOR], rgba, SHADER_ATTRIB_VEC4, 1);
+
+    rlActiveTextureSlot(0);
+    rlEnableTexture(rlGetTextureIdDefault());
+
+    rlEnableVertexArray(b->vao);
+    rlDrawVertexArray(0, count * 6);
+    rlDisableVertexArray();
+
+    rlDisableTexture();
+    rlDisableShader();
+    return 0;
+}
+
+int
+bars_draw(bars* b,
+          const float* values,
+          int count,
+          int top,
+          int w,
+          int h,
+          Color color)
+{
+    return draw(b, values, count, top, w, h, 0, color);
+}
+
+int
+bars_draw_caps(bars* b,
+               const float* values,
+               int count,
+               int top,
+               int w,
+               int h,
+               int thickness,
+               Color color)
+{
+    return draw(b, values, count, top, w, h, thickness, color);
+}
+
+void
+bars_free(bars* b)
+{
+    if (b->vbo != 0)
+        rlUnloadVertexBuffer(b->vbo);
+
+    if (b->vao != 0)
+        rlUnloadVertexArray(b->vao);
+
+    free(b->verts);
+    *b = (bars){ 0 };
+}
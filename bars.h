@@ -0,0 +1,77 @@
+#ifndef BARS
+#define BARS
+
+#include "raylib.h"
+
+// the visualizer's bars as one mesh, drawn with a single call
+//
+// the x positions are built once per window size and band count, each
+// frame only the tops of the bars are rewritten and uploaded
+
+typedef enum renderer
+{
+    // one DrawRectangle per band
+    RendererRects = 0,
+
+    // one vertex buffer, one draw call
+    RendererMesh = 1
+} renderer;
+
+#define RENDERERS 2
+
+typedef struct bars
+{
+    // 0 until the first draw, and when the gl has no vertex arrays
+    unsigned int vao;
+    unsigned int vbo;
+
+    // what the geometry was built for
+    int count;
+    int top;
+    int width;
+    int height;
+
+    // 6 vertices of x, y per bar, room for capacity bars
+    float* verts;
+    int capacity;
+} bars;
+
+const char*
+renderer_name(renderer r);
+
+// x and width of bar i of count over w pixels, the same rounding fixups
+// for both renderers so they cover the same pixels
+void
+bars_span(int i, int count, int w, int* x, int* width);
+
+void
+bars_init(bars* b);
+
+// draws count bars of values (0..1) filling w * h from y = top, returns 1
+// if the mesh could not be set up, the caller then falls back to the rects
+int
+bars_draw(bars* b,
+          const float* values,
+          int count,
+          int top,
+          int w,
+          int h,
+          Color color);
+
+// draws a cap of `thickness` pixels at the top of each of the bars
+// bars_draw() would draw, the peak markers, with the same fallback
+int
+bars_draw_caps(bars* b,
+               const float* values,
+               int count,
+               int top,
+               int w,
+               int h,
+               int thickness,
+               Color color);
+
+// needs the gl context, so before CloseWindow()
+void
+bars_free(bars* b);
+
+#endif
@@ -0,0 +1,836 @@
+// microbenchmarks of the dsp, no audio or window needed
+//
+// every case is calibrated to batches of at least BENCH_BATCH_NS, warmed
+// up, then timed over BENCH_SAMPLES batches, the per call median / p99 /
+// min / mean go to stdout as json and the progress to stderr, followed by
+// how far the q15 fft is from the float one
+//
+// usage: auvi_bench [filter], only cases whose name contains filter run
+
+#include "analyzer.h"
+#include "bands.h"
+#include "chuck_fft.h"
+#include "fft_q15.h"
+#include "filter.h"
+#include "goertzel.h"
+#include "spectrum.h"
+#include "timing.h"
+#include "util.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/utsname.h>
+#include <time.h>
+
+#define BENCH_SAMPLES 1000
+#define BENCH_WARMUP_NS 20000000LL
+#define BENCH_BATCH_NS 20000LL
+
+typedef void (*bench_fn)(void* ctx);
+
+typedef struct bench
+{
+    FILE* out;
+    const char* filter;
+    int results;
+    double samples[BENCH_SAMPLES];
+} bench;
+
+static int
+cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// calls per batch so a batch takes BENCH_BATCH_NS, always even so the
+// fft cases alternate back to where they started
+static long
+calibrate(bench_fn fn, void* ctx)
+{
+    long reps = 2;
+
+    for (;;) {
+        long long start = time_now_ns();
+        for (long i = 0; i < reps; i++)
+            fn(ctx);
+
+        if (time_now_ns() - start >= BENCH_BATCH_NS || reps >= (1L << 24))
+            return reps;
+
+        reps *= 2;
+    }
+}
+
+// times fn and writes a json result with the case name and its params,
+// `params` being json members like "\"size\": 256"
+static void
+run(bench* b, const char* name, const char* params, bench_fn fn, void* ctx)
+{
+    if (b->filter && strstr(name, b->filter) == NULL)
+        return;
+
+    long reps = calibrate(fn, ctx);
+
+    long long warm = time_now_ns() + BENCH_WARMUP_NS;
+    while (time_now_ns() < warm)
+        for (long i = 0; i < reps; i++)
+            fn(ctx);
+
+    double sum = 0;
+    for (int s = 0; s < BENCH_SAMPLES; s++) {
+        long long start = time_now_ns();
+        for (long i = 0; i < reps; i++)
+            fn(ctx);
+
+        b->samples[s] = (double)(time_now_ns() - start) / reps;
+        sum += b->samples[s];
+    }
+
+    qsort(b->samples, BENCH_SAMPLES, sizeof(double), cmp_double);
+
+    double median = b->samples[BENCH_SAMPLES / 2];
+    double p99 = b->samples[BENCH_SAMPLES * 99 / 100];
+
+    fprintf(b->out,
+            "%s    { \"name\": \"%s\", %s, \"iterations\": %ld, "
+            "\"median_ns\": %.1f, \"p99_ns\": %.1f, \"min_ns\": %.1f, "
+            "\"mean_ns\": %.1f }",
+            b->results ? ",\n" : "",
+            name,
+            params,
+            reps * BENCH_SAMPLES,
+            median,
+            p99,
+            b->samples[0],
+            sum / BENCH_SAMPLES);
+    b->results++;
+
+    fprintf(stderr,
+            "%-10s %-48s median %10.1f ns  p99 %10.1f ns\n",
+            name,
+            params,
+            median,
+            p99);
+}
+
+static void
+fill_noise(float* x, long n)
+{
+    unsigned int r = 1;
+    for (long i = 0; i < n; i++) {
+        r = r * 1664525u + 1013904223u;
+        x[i] = (float)(r >> 8) / (1 << 24) - 0.5f;
+    }
+}
+
+// fft
+
+typedef struct fft_case
+{
+    fft_plan* plan;
+    float* x;
+    int forward;
+} fft_case;
+
+// alternates forward and inverse so the data stays bounded without a copy
+// in the timed loop, both directions cost the same
+static void
+bench_rfft(void* ctx)
+{
+    fft_case* c = ctx;
+    rfft_plan(c->plan, c->x, c->forward);
+    c->forward = !c->forward;
+}
+
+// the history stays the same, only the fft runs
+static void
+bench_rfft_q15(void* ctx)
+{
+    q15_rfft(ctx, 0);
+}
+
+static void
+bench_cfft(void* ctx)
+{
+    fft_case* c = ctx;
+    cfft_plan(c->plan, c->x, c->forward);
+    c->forward = !c->forward;
+}
+
+static void
+bench_ffts(bench* b)
+{
+    char params[128];
+
+    for (int k = FFT_KERNEL_SCALAR; k <= FFT_KERNEL_AVX2; k++) {
+        if (!fft_set_kernel((fft_kernel)k))
+            continue;
+
+        for (long n = MIN_FFT_SIZE; n <= MAX_FFT_SIZE; n *= 2) {
+            fft_case c = { fft_plan_create(n / 2), malloc(n * sizeof(float)),
+                           FFT_FORWARD };
+
+            sprintf(params,
+                    "\"size\": %ld, \"kernel\": \"%s\"",
+                    n,
+                    fft_kernel_name((fft_kernel)k));
+
+            fill_noise(c.x, n);
+            run(b, "rfft", params, bench_rfft, &c);
+
+            // cfft of n complex values
+            fft_plan_destroy(c.plan);
+            c.plan = fft_plan_create(n);
+            c.x = realloc(c.x, 2 * n * sizeof(float));
+            c.forward = FFT_FORWARD;
+
+            fill_noise(c.x, 2 * n);
+            run(b, "cfft", params, bench_cfft, &c);
+
+            fft_plan_destroy(c.plan);
+            free(c.x);
+        }
+    }
+
+    fft_select_kernel();
+
+    for (long n = MIN_FFT_SIZE; n <= MAX_FFT_SIZE; n *= 2) {
+        fft_plan* plan = fft_plan_create(n / 2);
+        stft st = { 0 };
+        q15_fft q;
+
+        if (!plan || stft_init(&st, n, WindowHanning) || q15_init(&q, plan)) {
+            fft_plan_destroy(plan);
+            stft_free(&st);
+            continue;
+        }
+
+        short* x = malloc(n * sizeof(short));
+        unsigned int r = 1;
+        for (long i = 0; i < n; i++) {
+            r = r * 1664525u + 1013904223u;
+            x[i] = (short)(r >> 16);
+        }
+
+        q15_set_window(&q, &st);
+        q15_push(&q, 0, x, n);
+
+        sprintf(params, "\"size\": %ld, \"kernel\": \"q15\"", n);
+        run(b, "rfft", params, bench_rfft_q15, &q);
+
+        free(x);
+        q15_free(&q);
+        stft_free(&st);
+        fft_plan_destroy(plan);
+    }
+}
+
+// filters
+
+typedef struct filter_case
+{
+    float* fft;
+    float* tmp;
+    double* sums;
+    int n;
+    int range;
+} filter_case;
+
+static void
+bench_block(void* ctx)
+{
+    filter_case* c = ctx;
+    apply_block_filter(c->fft, c->n, c->range);
+}
+
+static void
+bench_box(void* ctx)
+{
+    filter_case* c = ctx;
+    apply_box_filter(c->fft, c->sums, c->n, c->range);
+}
+
+static void
+bench_weighted(void* ctx)
+{
+    filter_case* c = ctx;
+    apply_weighted_filter(c->fft, c->sums, c->n, c->range);
+}
+
+static void
+bench_exponential(void* ctx)
+{
+    filter_case* c = ctx;
+    apply_exponential_smoothing(c->fft, c->tmp, c->n, 0.2f);
+}
+
+static void
+bench_filters(bench* b)
+{
+    int sizes[] = { 64, 256, 1024, 4096 };
+    int ranges[] = { 1, 4, 16, 64 };
+    char params[128];
+
+    for (int s = 0; s < 4; s++) {
+        int n = sizes[s];
+        filter_case c = { malloc(n * sizeof(float)),
+                          malloc(n * sizeof(float)),
+                          malloc(FILTER_SUMS_SIZE(n) * sizeof(double)),
+                          n,
+                          0 };
+
+        for (int r = 0; r < 4; r++) {
+            c.range = ranges[r];
+            sprintf(params, "\"size\": %d, \"range\": %d", n, c.range);
+
+            fill_noise(c.fft, n);
+            run(b, "block", params, bench_block, &c);
+
+            fill_noise(c.fft, n);
+            run(b, "box", params, bench_box, &c);
+
+            fill_noise(c.fft, n);
+            run(b, "weighted", params, bench_weighted, &c);
+        }
+
+        sprintf(params, "\"size\": %d, \"alpha\": 0.2", n);
+        fill_noise(c.fft, n);
+        run(b, "exponential", params, bench_exponential, &c);
+
+        free(c.fft);
+        free(c.tmp);
+        free(c.sums);
+    }
+}
+
+// band mapping and the full frame
+
+typedef struct bands_case
+{
+    band_map map;
+    float* power;
+    float* out;
+} bands_case;
+
+static void
+bench_bands_apply(void* ctx)
+{
+    bands_case* c = ctx;
+    bands_apply(&c->map, c->power, c->out);
+}
+
+typedef struct goertzel_case
+{
+    goertzel_bank bank;
+    float* x;
+    float* tilt;
+    float* power;
+    int n;
+} goertzel_case;
+
+static void
+bench_goertzel(void* ctx)
+{
+    goertzel_case* c = ctx;
+    goertzel_power(&c->bank, c->x, c->n, c->tilt, c->power);
+}
+
+// a bank of `bins` list bands, spread over the spectrum, against the rfft
+// cases of the same size; goertzel_cheaper() decides between the two with
+// GOERTZEL_GROUP_COST and GOERTZEL_STAGE_COSTS, which are tuned from these
+// medians: a goertzel median over size * groups of GOERTZEL_LANES bins,
+// and an rfft median over size * log2(size) per kernel
+static void
+bench_goertzels(bench* b)
+{
+    int sizes[] = { 256, 1024, 4096 };
+    int counts[] = { 1, 4, 8, 16, 32 };
+    char params[128];
+
+    for (int s = 0; s < 3; s++) {
+        int n = sizes[s];
+
+        for (int k = 0; k < 5; k++) {
+            float freqs[32];
+            for (int i = 0; i < counts[k]; i++)
+                freqs[i] = 40.0f * (i + 1);
+
+            band_map map = { 0 };
+            goertzel_case c = { { 0 } };
+
+            if (bands_build(&map, BandList, counts[k], 1, 48000, n, freqs) ||
+                goertzel_init(&c.bank, &map, n)) {
+                bands_free(&map);
+                continue;
+            }
+
+            c.x = malloc(n * sizeof(float));
+            c.tilt = malloc(n * sizeof(float));
+            c.power = malloc(n / 2 * sizeof(float));
+            c.n = n;
+            fill_noise(c.x, n);
+            spectrum_make_tilt(c.tilt, n);
+
+            sprintf(params,
+                    "\"size\": %d, \"bins\": %d, \"cheaper\": %d",
+                    n,
+                    c.bank.count,
+                    goertzel_cheaper(&map, n));
+            run(b, "goertzel", params, bench_goertzel, &c);
+
+            free(c.x);
+            free(c.tilt);
+            free(c.power);
+            goertzel_free(&c.bank);
+            bands_free(&map);
+        }
+    }
+}
+
+static void
+bench_frame(void* ctx)
+{
+    an_process(ctx);
+}
+
+static void
+bench_bands(bench* b)
+{
+    int sizes[] = { 256, 1024, 4096 };
+    int counts[] = { 32, 128, 512 };
+    char params[128];
+
+    for (int s = 0; s < 3; s++) {
+        for (int l = 0; l < BAND_LAYOUTS; l++) {
+            for (int k = 0; k < 3; k++) {
+                bands_case c = { { 0 } };
+
+                if (bands_build(&c.map,
+                                (band_layout)l,
+                                counts[k],
+                                DEFAULT_OCTAVE_FRACTION,
+                                48000,
+                                sizes[s],
+                                NULL))
+                    continue;
+
+                c.power = malloc(sizes[s] / 2 * sizeof(float));
+                c.out = malloc(c.map.count * sizeof(float));
+                fill_noise(c.power, sizes[s] / 2);
+
+                sprintf(params,
+                        "\"size\": %d, \"layout\": \"%s\", \"bands\": %d",
+                        sizes[s],
+                        band_layout_name((band_layout)l),
+                        c.map.count);
+                run(b, "bands", params, bench_bands_apply, &c);
+
+                free(c.power);
+                free(c.out);
+                bands_free(&c.map);
+
+                // octave bands do not depend on the count
+                if (l == BandOctave)
+                    break;
+            }
+        }
+    }
+}
+
+static void
+bench_frames(bench* b)
+{
+    int sizes[] = { 256, 1024, 4096 };
+    char params[128];
+
+    for (int s = 0; s < 3; s++) {
+        analyzer an;
+        if (an_init(&an, 48000, sizes[s]))
+            continue;
+
+        // a tone that keeps every stage busy
+        unsigned char* samples = an.samples;
+        for (int i = 0; i < sizes[s]; i++)
+            samples[i] = 128 + (int)(100 * sin(i * 0.3));
+
+        sprintf(params,
+                "\"size\": %d, \"hop\": %d, \"bands\": %d, \"layout\": "
+                "\"%s\"",
+                sizes[s],
+                an.hop,
+                an.map.count,
+                band_layout_name(an.layout));
+        run(b, "frame", params, bench_frame, &an);
+
+        an.fft_path = FftQ15;
+        sprintf(params,
+                "\"size\": %d, \"hop\": %d, \"bands\": %d, \"layout\": "
+                "\"%s\", \"fft\": \"q15\"",
+                sizes[s],
+                an.hop,
+                an.map.count,
+                band_layout_name(an.layout));
+        run(b, "frame", params, bench_frame, &an);
+
+        an_free(&an);
+    }
+}
+
+// the per-bin post stage before and after the fused kernels: a hop of u8
+// samples through the window and the rfft, then either the tilt, double
+// sqrt / log10, clamp and decay one bin at a time, as analyzer.c did it,
+// or spectrum_power() and spectrum_post(), over every bin of both
+
+#define BENCH_POST_DECAY 0.8f
+
+typedef struct post_case
+{
+    unsigned char* samples;
+    stft st;
+    fft_plan* plan;
+    float* x;
+    float* tilt;
+    float* power;
+    float* fft;
+    int n;
+    int hop;
+} post_case;
+
+// the hop in x through the window and the rfft, the same for both
+static void
+post_rfft(post_case* c, float* x)
+{
+    stft_push(&c->st, x, c->hop);
+    stft_frame(&c->st, x);
+    rfft_plan(c->plan, x, FFT_FORWARD);
+
+    // remove dc component
+    x[0] = x[2];
+}
+
+static void
+bench_post_scalar(void* ctx)
+{
+    post_case* c = ctx;
+    float* x = c->x;
+    int n = c->n;
+    int shift = (float)(256.0f / 2);
+
+    for (int i = 0; i < c->hop; i++)
+        x[i] = (c->samples[i] - shift) * (1.0f / shift);
+
+    post_rfft(c, x);
+
+    for (int i = 0; i < n; i++)
+        x[i] *= 0.04f + (0.5f * (i / (float)n));
+
+    for (int i = 0; i < n / 2; i++) {
+        complex v = (complex){ x[2 * i], x[2 * i + 1] };
+        float mag = cmp_abs(v);
+
+        mag = (0.7f * log10(1.1f * mag)) + (0.7f * mag);
+        mag = clampf(mag, 0.0f, 1.0f);
+
+        float prev = c->fft[i];
+        c->fft[i] = mag > prev ? mag : prev * BENCH_POST_DECAY;
+    }
+}
+
+static void
+bench_post_fused(void* ctx)
+{
+    post_case* c = ctx;
+    float* x = c->x;
+
+    spectrum_ingest_u8(x, c->samples, c->hop, 1.0f);
+    post_rfft(c, x);
+
+    spectrum_power(x, c->tilt, c->power, c->n / 2);
+    spectrum_post(c->power, c->fft, c->n / 2, 0, BENCH_POST_DECAY);
+}
+
+static void
+bench_posts(bench* b)
+{
+    int sizes[] = { 256, 1024, 4096 };
+    char params[128];
+
+    for (int s = 0; s < 3; s++) {
+        int n = sizes[s];
+        post_case c = { 0 };
+
+        c.n = n;
+        c.hop = DEFAULT_HOP_SIZE;
+        c.samples = malloc(c.hop);
+        c.plan = fft_plan_create(n / 2);
+        c.x = malloc(n * sizeof(float));
+        c.tilt = malloc(n * sizeof(float));
+        c.power = malloc(n / 2 * sizeof(float));
+        c.fft = calloc(n / 2, sizeof(float));
+
+        int failed = stft_init(&c.st, n, WindowHanning) || !c.samples ||
+                     !c.plan || !c.x || !c.tilt || !c.power || !c.fft;
+
+        if (!failed) {
+            // a tone that keeps every stage busy
+            for (int i = 0; i < c.hop; i++)
+                c.samples[i] = 128 + (int)(100 * sin(i * 0.3));
+            spectrum_make_tilt(c.tilt, n);
+
+            sprintf(params,
+                    "\"size\": %d, \"hop\": %d, \"post\": \"scalar\"",
+                    n,
+                    c.hop);
+            run(b, "post", params, bench_post_scalar, &c);
+
+            sprintf(params,
+                    "\"size\": %d, \"hop\": %d, \"post\": \"fused\"",
+                    n,
+                    c.hop);
+            run(b, "post", params, bench_post_fused, &c);
+        }
+
+        stft_free(&c.st);
+        fft_plan_destroy(c.plan);
+        free(c.samples);
+        free(c.x);
+        free(c.tilt);
+        free(c.power);
+        free(c.fft);
+    }
+}
+
+// a frame of the block rfft against the sliding dft for a range of hops,
+// a hop of samples is what the bands wait for on top of the frame, so
+// hop_us + median_ns is the latency and median_ns / hop the cpu per sample
+static void
+bench_latencies(bench* b)
+{
+    int sizes[] = { 1024, 4096 };
+    int hops[] = { 1, 16, 64, 256 };
+    float freqs[] = { 60, 120, 440, 1000, 4000 };
+    char params[192];
+
+    for (int s = 0; s < 2; s++) {
+        for (int l = 0; l < 2; l++) {
+            analyzer an;
+            if (an_init(&an, 48000, sizes[s]))
+                continue;
+
+            memcpy(an.freqs, freqs, sizeof(freqs));
+            an.freq_count = 5;
+            if (an_set_bands(&an, l ? BandLog : BandList, 32, 1)) {
+                an_free(&an);
+                continue;
+            }
+
+            unsigned char* samples = an.samples;
+            for (int i = 0; i < sizes[s]; i++)
+                samples[i] = 128 + (int)(100 * sin(i * 0.3));
+
+            for (int p = FftFloat; p <= FftSliding; p += FftSliding) {
+                if (an_set_fft_path(&an, (fft_path)p))
+                    continue;
+
+                for (int h = 0; h < 4; h++) {
+                    an.hop = hops[h];
+
+                    sprintf(params,
+                            "\"size\": %d, \"hop\": %d, \"hop_us\": %.1f, "
+                            "\"bands\": %d, \"layout\": \"%s\", "
+                            "\"fft\": \"%s\"",
+                            sizes[s],
+                            an.hop,
+                            an.hop * 1e6 / an.sample_rate,
+                            an.map.count,
+                            band_layout_name(an.layout),
+                            fft_path_name(an_active_path(&an)));
+                    run(b, "latency", params, bench_frame, &an);
+                }
+            }
+
+            an_free(&an);
+        }
+    }
+}
+
+// accuracy of the q15 fft against the float one on the same samples
+
+typedef struct accuracy_signal
+{
+    const char* name;
+
+    // amplitude of the sine and of white noise, full scale is 1
+    double sine;
+    double noise;
+} accuracy_signal;
+
+static const accuracy_signal accuracy_signals[] = {
+    { "sine", 0.9, 0 },
+    { "quiet sine", 0.009, 0 },
+    { "sine in noise", 0.5, 0.1 },
+    { "noise", 0, 0.5 },
+};
+
+#define ACCURACY_SIGNALS 4
+
+// bins further below the peak than this are left out of the max error
+#define ACCURACY_FLOOR_DB -60
+
+// one signal, format and size: the ratio of the float spectrum to the
+// difference of the two over all bins but dc and nyquist in dB, and the
+// largest difference of a bin in dB
+static void
+accuracy(bench* b, const accuracy_signal* sig, sample_format format, int n)
+{
+    fft_plan* plan = fft_plan_create(n / 2);
+    stft st = { 0 };
+    q15_fft q;
+
+    if (!plan || stft_init(&st, n, WindowHanning) || q15_init(&q, plan)) {
+        fft_plan_destroy(plan);
+        stft_free(&st);
+        return;
+    }
+
+    unsigned char* u8 = malloc(n);
+    short* s16 = malloc(n * sizeof(short));
+    float* x = malloc(n * sizeof(float));
+
+    unsigned int r = 7;
+    for (int i = 0; i < n; i++) {
+        r = r * 1664525u + 1013904223u;
+        double v = sig->sine * sin(2 * M_PI * 0.1037 * i) +
+                   sig->noise * ((double)(r >> 8) / (1 << 23) - 1);
+
+        u8[i] = (unsigned char)lrint(128 + 127 * v);
+        s16[i] = (short)lrint(32767 * v);
+    }
+
+    if (format == SampleU8) {
+        spectrum_ingest_u8(x, u8, n, 1.0f);
+        q15_ingest_u8(s16, u8, n);
+    } else {
+        spectrum_ingest_s16(x, s16, n, 1.0f);
+    }
+
+    stft_push(&st, x, n);
+    stft_frame(&st, x);
+    rfft_plan(plan, x, FFT_FORWARD);
+
+    q15_set_window(&q, &st);
+    q15_push(&q, 0, s16, n);
+    q15_rfft(&q, 0);
+    float scale = q15_scale(&q, 1.0f);
+
+    double signal = 0;
+    double error = 0;
+    double peak = 0;
+
+    for (int k = 1; k < n / 2; k++) {
+        double re = x[2 * k];
+        double im = x[2 * k + 1];
+        double dr = q.out[2 * k] * scale - re;
+        double di = q.out[2 * k + 1] * scale - im;
+
+        signal += re * re + im * im;
+        error += dr * dr + di * di;
+        peak = fmax(peak, re * re + im * im);
+    }
+
+    double max_error = 0;
+    double floor = peak * pow(10, ACCURACY_FLOOR_DB / 10.0);
+
+    for (int k = 1; k < n / 2; k++) {
+        double re = x[2 * k];
+        double im = x[2 * k + 1];
+        double f = re * re + im * im;
+        double qr = q.out[2 * k] * scale;
+        double qi = q.out[2 * k + 1] * scale;
+
+        if (f >= floor && f > 0)
+            max_error =
+              fmax(max_error, fabs(10 * log10((qr * qr + qi * qi) / f)));
+    }
+
+    double snr = error > 0 ? 10 * log10(signal / error) : INFINITY;
+
+    fprintf(b->out,
+            "%s    { \"signal\": \"%s\", \"format\": \"%s\", "
+            "\"size\": %d, \"snr_db\": %.1f, \"max_error_db\": %.3f, "
+            "\"exponent\": %d }",
+            b->results ? ",\n" : "",
+            sig->name,
+            sample_format_name(format),
+            n,
+            snr,
+            max_error,
+            q.exponent);
+    b->results++;
+
+    fprintf(stderr,
+            "q15 %-14s %-3s %6d  snr %6.1f dB  max error %6.3f dB\n",
+            sig->name,
+            sample_format_name(format),
+            n,
+            snr,
+            max_error);
+
+    free(u8);
+    free(s16);
+    free(x);
+    q15_free(&q);
+    stft_free(&st);
+    fft_plan_destroy(plan);
+}
+
+static void
+bench_accuracy(bench* b)
+{
+    int sizes[] = { 256, 1024, 4096 };
+
+    for (int i = 0; i < ACCURACY_SIGNALS; i++)
+        for (int f = SampleU8; f <= SampleS16; f++)
+            for (int s = 0; s < 3; s++)
+                accuracy(b, &accuracy_signals[i], (sample_format)f, sizes[s]);
+}
+
+int
+main(int argc, char** argv)
+{
+    bench b = { stdout, argc > 1 ? argv[1] : NULL, 0 };
+
+    struct utsname host;
+    uname(&host);
+
+    fft_select_kernel();
+
+    fprintf(b.out,
+            "{\n  \"host\": \"%s\",\n  \"machine\": \"%s\",\n"
+            "  \"time\": %lld,\n  \"fft_kernel\": \"%s\",\n"
+            "  \"samples\": %d,\n  \"results\": [\n",
+            host.nodename,
+            host.machine,
+            (long long)time(NULL),
+            fft_kernel_name(fft_get_kernel()),
+            BENCH_SAMPLES);
+
+    bench_ffts(&b);
+    bench_filters(&b);
+    bench_bands(&b);
+    bench_goertzels(&b);
+    bench_frames(&b);
+    bench_posts(&b);
+    bench_latencies(&b);
+
+    // not timed, so not filtered
+    fprintf(b.out, "\n  ],\n  \"accuracy\": [\n");
+    b.results = 0;
+    bench_accuracy(&b);
+
+    fprintf(b.out, "\n  ]\n}\n");
+    return 0;
+}
@@ -0,0 +1,406 @@
+#include "capture.h"
+#include "generator.h"
+#include "timing.h"
+#include "wav.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "AL/al.h"
+#include "AL/alc.h"
+
+// samples a fast generator reports at once
+#define GEN_FAST_CHUNK (1 << 16)
+
+const capture_backend*
+capture_find(const char* name)
+{
+    const capture_backend* backends[CAPTURE_BACKENDS] = {
+        &capture_openal,
+        &capture_wav,
+        &capture_raw,
+        &capture_generator,
+    };
+
+    for (int i = 0; i < CAPTURE_BACKENDS; i++)
+        if (strcmp(name, backends[i]->name) == 0)
+            return backends[i];
+
+    return NULL;
+}
+
+int
+capture_open(capture* cap,
+             const capture_backend* backend,
+             const char* source,
+             int sample_rate,
+             int buffer_samples)
+{
+    cap->backend = backend;
+    cap->sample_rate = sample_rate;
+    cap->channels = 1;
+    cap->eof = 0;
+    cap->state = NULL;
+
+    if (backend->open(cap, source, sample_rate, buffer_samples)) {
+        cap->backend = NULL;
+        return 1;
+    }
+
+    return 0;
+}
+
+int
+capture_available(capture* cap)
+{
+    return cap->backend->available(cap);
+}
+
+int
+capture_read(capture* cap, void* out, int n)
+{
+    return cap->backend->read(cap, out, n);
+}
+
+void
+capture_close(capture* cap)
+{
+    if (cap->backend == NULL)
+        return;
+
+    cap->backend->close(cap);
+    cap->backend = NULL;
+    cap->state = NULL;
+}
+
+// samples due by now for a source paced to its sample rate, counted from
+// the first call
+static long long
+paced_due(long long* start, long long read, int sample_rate)
+{
+    long long now = time_now_ns();
+
+    if (*start == 0)
+        *start = now;
+
+    return (now - *start) * sample_rate / NS_PER_SEC - read;
+}
+
+static int
+clamp_count(long long n)
+{
+    return n < 0 ? 0 : (n > INT_MAX ? INT_MAX : (int)n);
+}
+
+// openal
+
+// the openal format of the samples, 0 if the implementation has none,
+// float needs AL_EXT_float32
+static ALenum
+openal_format(sample_format format, int channels)
+{
+    switch (format) {
+        case SampleU8:
+            return channels == 2 ? AL_FORMAT_STEREO8 : AL_FORMAT_MONO8;
+        case SampleS16:
+            return channels == 2 ? AL_FORMAT_STEREO16 : AL_FORMAT_MONO16;
+        default:
+            return alGetEnumValue(channels == 2 ? "AL_FORMAT_STEREO_FLOAT32"
+                                                : "AL_FORMAT_MONO_FLOAT32");
+    }
+}
+
+static int
+openal_open(capture* cap, const char* source, int sample_rate, int buffer)
+{
+    sample_format format = cap->want_format;
+    ALenum al_format = openal_format(format, cap->want_channels);
+
+    ALCdevice* device = NULL;
+    if (al_format != 0)
+        device =
+          alcCaptureOpenDevice(source, sample_rate, al_format, buffer);
+
+    if (device == NULL && format == SampleF32) {
+        printf("no float capture, using s16\n");
+
+        format = SampleS16;
+        al_format = openal_format(format, cap->want_channels);
+        device =
+          alcCaptureOpenDevice(source, sample_rate, al_format, buffer);
+    }
+
+    if (device == NULL)
+        return 1;
+
+    alcCaptureStart(device);
+
+    cap->format = format;
+    cap->channels = cap->want_channels;
+    cap->state = device;
+    return 0;
+}
+
+static int
+openal_available(capture* cap)
+{
+    ALCint samples = 0;
+    alcGetIntegerv(cap->state, ALC_CAPTURE_SAMPLES, 1, &samples);
+    return samples;
+}
+
+static int
+openal_read(capture* cap, void* out, int n)
+{
+    alcCaptureSamples(cap->state, (ALCvoid*)out, n);
+    return n;
+}
+
+static void
+openal_close(capture* cap)
+{
+    alcCaptureStop(cap->state);
+    alcCaptureCloseDevice(cap->state);
+}
+
+const capture_backend capture_openal = {
+    "openal", 1, openal_open, openal_available, openal_read, openal_close,
+};
+
+// wav files
+
+typedef struct wav_source
+{
+    wav_file wav;
+    long long start;
+} wav_source;
+
+static int
+wav_source_open(capture* cap, const char* source, int sample_rate, int buffer)
+{
+    wav_source* s = malloc(sizeof(wav_source));
+    if (s == NULL)
+        return 1;
+
+    if (wav_open(&s->wav, source)) {
+        free(s);
+        return 1;
+    }
+
+    s->start = 0;
+
+    cap->format = s->wav.format;
+    cap->channels = s->wav.channels;
+    cap->sample_rate = s->wav.sample_rate;
+    cap->state = s;
+    return 0;
+}
+
+static int
+wav_source_available(capture* cap)
+{
+    wav_source* s = cap->state;
+    long long left = s->wav.frames - s->wav.pos;
+    long long due = left;
+
+    if (cap->realtime)
+        due = paced_due(&s->start, s->wav.pos, cap->sample_rate);
+
+    // once the rest is due, a tail shorter than a hop ends the stream
+    if (due >= left) {
+        cap->eof = 1;
+        due = left;
+    }
+
+    return clamp_count(due);
+}
+
+static int
+wav_source_read(capture* cap, void* out, int n)
+{
+    wav_source* s = cap->state;
+    return wav_read(&s->wav, out, n);
+}
+
+static void
+wav_source_close(capture* cap)
+{
+    wav_source* s = cap->state;
+    wav_close(&s->wav);
+    free(s);
+}
+
+const capture_backend capture_wav = {
+    "wav",
+    0,
+    wav_source_open,
+    wav_source_available,
+    wav_source_read,
+    wav_source_close,
+};
+
+// raw pcm from stdin or a fifo
+
+typedef struct raw_source
+{
+    int fd;
+
+    // bytes per frame
+    int frame_size;
+
+    // a regular file has all its samples queued from the start
+    int regular;
+} raw_source;
+
+static int
+raw_open(capture* cap, const char* source, int sample_rate, int buffer)
+{
+    raw_source* s = malloc(sizeof(raw_source));
+    if (s == NULL)
+        return 1;
+
+    // opening a fifo waits for its writer
+    s->fd = strcmp(source, "-") == 0 ? STDIN_FILENO : open(source, O_RDONLY);
+    if (s->fd < 0) {
+        printf("could not open %s\n", source);
+        free(s);
+        return 1;
+    }
+
+    struct stat st;
+    s->regular = fstat(s->fd, &st) == 0 && S_ISREG(st.st_mode);
+    s->frame_size = sample_size(cap->want_format) * cap->want_channels;
+
+    cap->format = cap->want_format;
+    cap->channels = cap->want_channels;
+    cap->state = s;
+    return 0;
+}
+
+static int
+raw_available(capture* cap)
+{
+    raw_source* s = cap->state;
+
+    // poll first: readable with nothing queued after it, or a hang up,
+    // means the writer is gone and what is queued is all that is left,
+    // which may end in less than a hop or a frame
+    struct pollfd p = { s->fd, POLLIN, 0 };
+    int ready = poll(&p, 1, 0);
+
+    int bytes = 0;
+    if (ioctl(s->fd, FIONREAD, &bytes) < 0)
+        bytes = 0;
+
+    if (s->regular || (ready > 0 && (bytes == 0 || (p.revents & POLLHUP))))
+        cap->eof = 1;
+
+    return bytes / s->frame_size;
+}
+
+static int
+raw_read(capture* cap, void* out, int n)
+{
+    raw_source* s = cap->state;
+    char* p = out;
+    size_t want = (size_t)n * s->frame_size;
+    size_t got = 0;
+
+    while (got < want) {
+        ssize_t r = read(s->fd, p + got, want - got);
+        if (r <= 0) {
+            cap->eof = 1;
+            break;
+        }
+        got += r;
+    }
+
+    return got / s->frame_size;
+}
+
+static void
+raw_close(capture* cap)
+{
+    raw_source* s = cap->state;
+
+    if (s->fd != STDIN_FILENO)
+        close(s->fd);
+
+    free(s);
+}
+
+const capture_backend capture_raw = {
+    "raw", 0, raw_open, raw_available, raw_read, raw_close,
+};
+
+// generated signals
+
+typedef struct gen_source
+{
+    generator gen;
+    long long start;
+    long long read;
+} gen_source;
+
+static int
+gen_source_open(capture* cap, const char* source, int sample_rate, int buffer)
+{
+    gen_source* s = malloc(sizeof(gen_source));
+    if (s == NULL)
+        return 1;
+
+    if (gen_init(&s->gen, source, sample_rate)) {
+        printf("invalid signal: %s\n", source);
+        free(s);
+        return 1;
+    }
+
+    s->start = 0;
+    s->read = 0;
+
+    cap->format = SampleF32;
+    cap->state = s;
+    return 0;
+}
+
+static int
+gen_source_available(capture* cap)
+{
+    gen_source* s = cap->state;
+
+    if (!cap->realtime)
+        return GEN_FAST_CHUNK;
+
+    return clamp_count(paced_due(&s->start, s->read, cap->sample_rate));
+}
+
+static int
+gen_source_read(capture* cap, void* out, int n)
+{
+    gen_source* s = cap->state;
+
+    gen_fill(&s->gen, out, n);
+    s->read += n;
+    return n;
+}
+
+static void
+gen_source_close(capture* cap)
+{
+    free(cap->state);
+}
+
+const capture_backend capture_generator = {
+    "gen",
+    1,
+    gen_source_open,
+    gen_source_available,
+    gen_source_read,
+    gen_source_close,
+};
@@ -0,0 +1,95 @@
+#ifndef CAPTURE
+#define CAPTURE
+
+#include "spectrum.h"
+
+// sources of samples for the analyzer, frames of cap->channels
+// interleaved samples in cap->format
+//
+// a backend fills in the calls update() and reinit_device() need, its
+// state lives behind cap->state
+
+typedef struct capture capture;
+
+typedef struct capture_backend
+{
+    const char* name;
+
+    // 1 if the source can be closed and opened again, e.g. for a new
+    // sample rate, 0 for streams that would lose their place
+    int restartable;
+
+    // opens `source` (device name, file path, signal spec) at sample_rate
+    // with room for buffer_samples frames, sets cap->format,
+    // cap->channels and, if the source has its own, cap->sample_rate
+    // returns 1 on failure
+    int (*open)(capture* cap,
+                const char* source,
+                int sample_rate,
+                int buffer_samples);
+
+    // frames that can be read right now, sets cap->eof once the source
+    // has ended
+    int (*available)(capture* cap);
+
+    // reads n frames, n <= available()
+    // returns the frames read
+    int (*read)(capture* cap, void* out, int n);
+
+    void (*close)(capture* cap);
+} capture_backend;
+
+struct capture
+{
+    const capture_backend* backend;
+
+    int sample_rate;
+    sample_format format;
+
+    // samples per frame, 1 or 2 (left, right)
+    int channels;
+
+    // file and generator sources: 1 to deliver samples at the rate they
+    // would have been captured, 0 as fast as they are read
+    int realtime;
+
+    // openal and raw sources: the samples and channels asked for, openal
+    // falls back to s16 without float capture
+    sample_format want_format;
+    int want_channels;
+
+    // set once a file or stream has nothing beyond what is available
+    int eof;
+
+    void* state;
+};
+
+extern const capture_backend capture_openal;
+extern const capture_backend capture_wav;
+extern const capture_backend capture_raw;
+extern const capture_backend capture_generator;
+
+#define CAPTURE_BACKENDS 4
+
+// the backends by name: openal, wav, raw, gen
+const capture_backend*
+capture_find(const char* name);
+
+// returns 1 on failure, leaving cap closed
+int
+capture_open(capture* cap,
+             const capture_backend* backend,
+             const char* source,
+             int sample_rate,
+             int buffer_samples);
+
+int
+capture_available(capture* cap);
+
+int
+capture_read(capture* cap, void* out, int n);
+
+void
+capture_close(capture* cap);
+
+#endif
@@ -8,7 +8,9 @@
 // date: 11.27.2003
 //-----------------------------------------------------------------------------
 #include "chuck_fft.h"
+#include "fft_simd.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 
@@ -233,10 +235,6 @@ void cfft(float * x, long NC, unsigned int forward)
                 j = i + mmax;
                 rtemp = wr*x[j] - wi*x[j + 1];
                 itemp = wr*x[j + 1] + wi*x[j];
-                if (j >= 511 || i >= 511)
-                {
-                    j = 0;
-                }
                 x[j] = x[i] - rtemp;
                 x[j + 1] = x[i + 1] - itemp;
                 x[i] += rtemp;
@@ -282,3 +280,330 @@ void bit_reverse(float * x, long N)
             j -= m;
     }
 }
+
+
+
+
+static fft_kernel fft_active_kernel = FFT_KERNEL_SCALAR;
+static int fft_kernel_selected = 0;
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: fft_kernel_name()
+// desc: printable name of a kernel
+//-----------------------------------------------------------------------------
+const char * fft_kernel_name(fft_kernel k)
+{
+    switch (k)
+    {
+        case FFT_KERNEL_SSE2: return "sse2";
+        case FFT_KERNEL_AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: fft_set_kernel()
+// desc: use kernel k for cfft_plan(), returns 0 if the cpu lacks support
+//-----------------------------------------------------------------------------
+int fft_set_kernel(fft_kernel k)
+{
+    if (k == FFT_KERNEL_SSE2 && !fft_cpu_has_sse2())
+        return 0;
+    if (k == FFT_KERNEL_AVX2 && !fft_cpu_has_avx2())
+        return 0;
+
+    fft_active_kernel = k;
+    fft_kernel_selected = 1;
+    return 1;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: fft_select_kernel()
+// desc: pick the widest kernel cpuid reports, AUVI_FFT_KERNEL=scalar|sse2|avx2
+//       overrides it for comparisons
+//-----------------------------------------------------------------------------
+void fft_select_kernel(void)
+{
+    const char * env = getenv("AUVI_FFT_KERNEL");
+    fft_kernel k;
+
+    if (env)
+    {
+        for (k = FFT_KERNEL_SCALAR; k <= FFT_KERNEL_AVX2; k++)
+            if (strcmp(env, fft_kernel_name(k)) == 0 && fft_set_kernel(k))
+                return;
+    }
+
+    if (!fft_set_kernel(FFT_KERNEL_AVX2) && !fft_set_kernel(FFT_KERNEL_SSE2))
+        fft_set_kernel(FFT_KERNEL_SCALAR);
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: fft_get_kernel()
+// desc: kernel cfft_plan() currently uses
+//-----------------------------------------------------------------------------
+fft_kernel fft_get_kernel(void)
+{
+    if (!fft_kernel_selected)
+        fft_select_kernel();
+    return fft_active_kernel;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: fft_plan_create()
+// desc: precompute the tables for transforms of N complex values (2*N reals
+//       for rfft_plan()), so no trig is done per transform
+//
+//   N MUST be a power of 2, no larger than FFT_PLAN_MAX_SIZE.
+//   returns NULL on invalid size or allocation failure.
+//
+//-----------------------------------------------------------------------------
+fft_plan * fft_plan_create(long N)
+{
+    fft_plan * plan;
+    long i, j, m, L, k, nswaps;
+    double pi = 4. * atan(1.);
+
+    if (N < 1 || N > FFT_PLAN_MAX_SIZE || (N & (N - 1)) != 0)
+        return NULL;
+
+    if (!fft_kernel_selected)
+        fft_select_kernel();
+
+    plan = (fft_plan *)calloc(1, sizeof(fft_plan));
+    if (!plan)
+        return NULL;
+
+    plan->N = N;
+
+    // bit reversal: count the exchanges first, then record them
+    nswaps = 0;
+    for (i = j = 0; i < N; i++)
+    {
+        if (j > i)
+            nswaps++;
+        for (m = N >> 1; m >= 1 && j >= m; m >>= 1)
+            j -= m;
+        j += m;
+    }
+
+    plan->swaps = (unsigned int *)malloc((nswaps ? nswaps : 1) * 2 * sizeof(unsigned int));
+    // cfft: stage with half size L uses L twiddles, stored at offset L - 1
+    plan->twiddle = (float *)malloc((N > 1 ? N - 1 : 1) * 2 * sizeof(float));
+    // rfft: one twiddle per output pair, 0..N/2
+    plan->rtwiddle = (float *)malloc(((N >> 1) + 1) * 2 * sizeof(float));
+
+    if (!plan->swaps || !plan->twiddle || !plan->rtwiddle)
+    {
+        fft_plan_destroy(plan);
+        return NULL;
+    }
+
+    plan->nswaps = nswaps;
+    nswaps = 0;
+    for (i = j = 0; i < N; i++)
+    {
+        if (j > i)
+        {
+            plan->swaps[2 * nswaps] = (unsigned int)i;
+            plan->swaps[2 * nswaps + 1] = (unsigned int)j;
+            nswaps++;
+        }
+        for (m = N >> 1; m >= 1 && j >= m; m >>= 1)
+            j -= m;
+        j += m;
+    }
+
+    for (L = 1; L < N; L <<= 1)
+    {
+        for (k = 0; k < L; k++)
+        {
+            plan->twiddle[2 * (L - 1 + k)] = (float)cos(pi * k / L);
+            plan->twiddle[2 * (L - 1 + k) + 1] = (float)sin(pi * k / L);
+        }
+    }
+
+    for (i = 0; i <= N >> 1; i++)
+    {
+        plan->rtwiddle[2 * i] = (float)cos(pi * i / N);
+        plan->rtwiddle[2 * i + 1] = (float)sin(pi * i / N);
+    }
+
+    return plan;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: fft_plan_destroy()
+// desc: free a plan and its tables
+//-----------------------------------------------------------------------------
+void fft_plan_destroy(fft_plan * plan)
+{
+    if (!plan)
+        return;
+
+    free(plan->swaps);
+    free(plan->twiddle);
+    free(plan->rtwiddle);
+    free(plan);
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: rfft_plan()
+// desc: rfft() on 2*plan->N real values using the plan tables
+//-----------------------------------------------------------------------------
+void rfft_plan(fft_plan * plan, float * x, unsigned int forward)
+{
+    float c1, c2, h1r, h1i, h2r, h2i, wr, wi, sign;
+    float xr, xi;
+    long i, i1, i2, i3, i4, N2p1, N = plan->N;
+
+    c1 = 0.5;
+    sign = forward ? 1.f : -1.f;
+
+    if (forward)
+    {
+        c2 = -0.5;
+        cfft_plan(plan, x, forward);
+        xr = x[0];
+        xi = x[1];
+    }
+    else
+    {
+        c2 = 0.5;
+        xr = x[1];
+        xi = 0.;
+        x[1] = 0.;
+    }
+
+    N2p1 = (N << 1) + 1;
+
+    for (i = 0; i <= N >> 1; i++)
+    {
+        i1 = i << 1;
+        i2 = i1 + 1;
+        i3 = N2p1 - i2;
+        i4 = i3 + 1;
+        wr = plan->rtwiddle[i1];
+        wi = sign * plan->rtwiddle[i2];
+        if (i == 0)
+        {
+            h1r = c1*(x[i1] + xr);
+            h1i = c1*(x[i2] - xi);
+            h2r = -c2*(x[i2] + xi);
+            h2i = c2*(x[i1] - xr);
+            x[i1] = h1r + wr*h2r - wi*h2i;
+            x[i2] = h1i + wr*h2i + wi*h2r;
+            xr = h1r - wr*h2r + wi*h2i;
+            xi = -h1i + wr*h2i + wi*h2r;
+        }
+        else
+        {
+            h1r = c1*(x[i1] + x[i3]);
+            h1i = c1*(x[i2] - x[i4]);
+            h2r = -c2*(x[i2] + x[i4]);
+            h2i = c2*(x[i1] - x[i3]);
+            x[i1] = h1r + wr*h2r - wi*h2i;
+            x[i2] = h1i + wr*h2i + wi*h2r;
+            x[i3] = h1r - wr*h2r + wi*h2i;
+            x[i4] = -h1i + wr*h2i + wi*h2r;
+        }
+    }
+
+    if (forward)
+        x[1] = xr;
+    else
+        cfft_plan(plan, x, forward);
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: cfft_plan()
+// desc: cfft() on plan->N complex values using the plan tables
+//
+//   the butterflies walk each block with contiguous twiddles instead of
+//   striding over the whole array once per twiddle.
+//
+//-----------------------------------------------------------------------------
+void cfft_plan(fft_plan * plan, float * x, unsigned int forward)
+{
+    long ND = plan->N << 1;
+    long i, k, L, b, delta;
+    float wr, wi, rtemp, itemp, scale, sign;
+    float *xa, *xb, *tw;
+
+    // bit reversal
+    for (i = 0; i < plan->nswaps; i++)
+    {
+        long p = (long)plan->swaps[2 * i] << 1;
+        long q = (long)plan->swaps[2 * i + 1] << 1;
+        rtemp = x[q]; itemp = x[q + 1]; /* complex exchange */
+        x[q] = x[p]; x[q + 1] = x[p + 1];
+        x[p] = rtemp; x[p + 1] = itemp;
+    }
+
+    scale = (float)(forward ? 1. / ND : 2.);
+
+    if (fft_active_kernel != FFT_KERNEL_SCALAR && plan->N >= 4)
+    {
+        fft_radix4_first_pass(x, plan->N, forward);
+        if (fft_active_kernel == FFT_KERNEL_AVX2)
+            fft_stages_avx2(x, plan->N, plan->twiddle, forward, scale);
+        else
+            fft_stages_sse2(x, plan->N, plan->twiddle, forward, scale);
+        return;
+    }
+
+    sign = forward ? 1.f : -1.f;
+
+    // L complex values per half block
+    for (L = 1; L < plan->N; L <<= 1)
+    {
+        delta = L << 2;
+        tw = plan->twiddle + 2 * (L - 1);
+
+        for (b = 0; b < ND; b += delta)
+        {
+            xa = x + b;
+            xb = xa + (L << 1);
+
+            for (k = 0; k < L; k++)
+            {
+                wr = tw[2 * k];
+                wi = sign * tw[2 * k + 1];
+                rtemp = wr*xb[2 * k] - wi*xb[2 * k + 1];
+                itemp = wr*xb[2 * k + 1] + wi*xb[2 * k];
+                xb[2 * k] = xa[2 * k] - rtemp;
+                xb[2 * k + 1] = xa[2 * k + 1] - itemp;
+                xa[2 * k] += rtemp;
+                xa[2 * k + 1] += itemp;
+            }
+        }
+    }
+
+    // scale output
+    for (i = 0; i < ND; i++)
+        x[i] *= scale;
+}
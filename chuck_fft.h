@@ -20,6 +20,42 @@ typedef struct { float re ; float im ; } complex;
 #define FFT_FORWARD 1
 #define FFT_INVERSE 0
 
+// largest N (complex values) a plan can be created for
+#define FFT_PLAN_MAX_SIZE ( 1L << 20 )
+
+// butterfly kernels cfft_plan() can run on
+//
+//   the sse2 / avx2 kernels do the first two stages as one radix-4 pass with
+//   exact +-i twiddles and the remaining radix-2 stages vectorized with the
+//   same per butterfly arithmetic as the scalar loop, their output matches
+//   the scalar kernel within FFT_KERNEL_TOLERANCE * max|X| (the float
+//   cos(pi/2) residue of the scalar stage two and fused multiply-adds the
+//   compiler may contract differently), `make fft-test` checks it
+#ifndef FFT_KERNEL_TOLERANCE
+#define FFT_KERNEL_TOLERANCE 1e-6
+#endif
+
+typedef enum fft_kernel
+{
+    FFT_KERNEL_SCALAR = 0,
+    FFT_KERNEL_SSE2,
+    FFT_KERNEL_AVX2
+} fft_kernel;
+
+// precomputed tables for transforms of one size
+typedef struct fft_plan
+{
+    // number of complex values, rfft_plan() works on 2*N reals
+    long N;
+    // bit reversal exchanges, pairs of complex indices
+    unsigned int * swaps;
+    long nswaps;
+    // cfft twiddles (re, im) of the forward transform, stage by stage
+    float * twiddle;
+    // rfft post-processing twiddles (re, im), 0..N/2
+    float * rtwiddle;
+} fft_plan;
+
 // c linkage
 #if ( defined( __cplusplus ) || defined( _cplusplus ) )
   extern "C" {
@@ -37,6 +73,21 @@ void rfft( float * x, long N, unsigned int forward );
 // complex fft, NC must be power of 2
 void cfft( float * x, long NC, unsigned int forward );
 
+// pick the widest kernel the cpu supports (done by the first
+// fft_plan_create() if not called before)
+void fft_select_kernel( void );
+// force a kernel, returns 0 if the cpu does not support it
+int fft_set_kernel( fft_kernel k );
+fft_kernel fft_get_kernel( void );
+const char * fft_kernel_name( fft_kernel k );
+
+// create a plan for N complex values, N must be power of 2
+fft_plan * fft_plan_create( long N );
+void fft_plan_destroy( fft_plan * plan );
+// same as rfft() / cfft() with N taken from the plan
+void rfft_plan( fft_plan * plan, float * x, unsigned int forward );
+void cfft_plan( fft_plan * plan, float * x, unsigned int forward );
+
 // c linkage
 #if ( defined( __cplusplus ) || defined( _cplusplus ) )
   }
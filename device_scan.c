@@ -0,0 +1,216 @@
+#include "device_scan.h"
+#include "timing.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "AL/al.h"
+#include "AL/alc.h"
+
+size_t
+devices_enumerate(char*** names)
+{
+    // a list of strings ending in an empty one, only valid until the next
+    // call
+    const ALCchar* devices = alcGetString(NULL, ALC_CAPTURE_DEVICE_SPECIFIER);
+    size_t count = 0;
+
+    *names = NULL;
+
+    while (devices != NULL && *devices) {
+        char** grown = realloc(*names, (count + 1) * sizeof(char*));
+        char* name = strdup(devices);
+
+        if (grown == NULL || name == NULL) {
+            free(name);
+            if (grown != NULL)
+                *names = grown;
+            break;
+        }
+
+        *names = grown;
+        (*names)[count++] = name;
+
+        devices += strlen(devices) + 1;
+    }
+
+    return count;
+}
+
+void
+devices_free(char** names, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        free(names[i]);
+
+    free(names);
+}
+
+static int
+same(char** a, size_t a_count, char** b, size_t b_count)
+{
+    if (a_count != b_count)
+        return 0;
+
+    for (size_t i = 0; i < a_count; i++)
+        if (strcmp(a[i], b[i]) != 0)
+            return 0;
+
+    return 1;
+}
+
+// returns the copy, NULL when empty or out of memory
+static char**
+copy(char** names, size_t count, size_t* copied)
+{
+    char** c = count > 0 ? calloc(count, sizeof(char*)) : NULL;
+
+    *copied = 0;
+    if (c == NULL)
+        return NULL;
+
+    for (size_t i = 0; i < count; i++) {
+        c[i] = strdup(names[i]);
+        if (c[i] == NULL) {
+            devices_free(c, i);
+            return NULL;
+        }
+    }
+
+    *copied = count;
+    return c;
+}
+
+static void*
+run(void* arg)
+{
+    device_scan* s = arg;
+
+    pthread_mutex_lock(&s->lock);
+
+    while (!s->stop) {
+        long long ns = time_now_ns() + DEVICE_RESCAN_NS;
+        struct timespec ts = { ns / NS_PER_SEC, ns % NS_PER_SEC };
+
+        while (!s->stop && !s->now)
+            if (pthread_cond_timedwait(&s->wake, &s->lock, &ts) != 0)
+                break;
+
+        if (s->stop)
+            break;
+
+        s->now = 0;
+        pthread_mutex_unlock(&s->lock);
+
+        char** names;
+        size_t count = devices_enumerate(&names);
+
+        pthread_mutex_lock(&s->lock);
+
+        if (same(names, count, s->seen, s->seen_count)) {
+            devices_free(names, count);
+            continue;
+        }
+
+        devices_free(s->seen, s->seen_count);
+        devices_free(s->names, s->count);
+
+        s->seen = names;
+        s->seen_count = count;
+        s->names = copy(names, count, &s->count);
+        s->generation++;
+    }
+
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+int
+scan_start(device_scan* s, char** names, size_t count)
+{
+    pthread_condattr_t attr;
+
+    s->running = 0;
+    s->stop = 0;
+    s->now = 0;
+    s->names = NULL;
+    s->count = 0;
+    s->generation = 0;
+    s->seen = copy(names, count, &s->seen_count);
+
+    if (pthread_condattr_init(&attr))
+        return 1;
+
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+    int failed = pthread_mutex_init(&s->lock, NULL) ||
+                 pthread_cond_init(&s->wake, &attr) ||
+                 pthread_create(&s->thread, NULL, run, s);
+
+    pthread_condattr_destroy(&attr);
+
+    s->running = !failed;
+    return failed;
+}
+
+void
+scan_request(device_scan* s)
+{
+    if (!s->running)
+        return;
+
+    pthread_mutex_lock(&s->lock);
+    s->now = 1;
+    pthread_cond_signal(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+}
+
+int
+scan_take(device_scan* s,
+          unsigned long* generation,
+          char*** names,
+          size_t* count)
+{
+    if (!s->running)
+        return 0;
+
+    pthread_mutex_lock(&s->lock);
+
+    int newer = s->generation != *generation;
+    if (newer) {
+        *generation = s->generation;
+        *names = s->names;
+        *count = s->count;
+
+        s->names = NULL;
+        s->count = 0;
+    }
+
+    pthread_mutex_unlock(&s->lock);
+    return newer;
+}
+
+void
+scan_stop(device_scan* s)
+{
+    if (!s->running)
+        return;
+
+    pthread_mutex_lock(&s->lock);
+    s->stop = 1;
+    pthread_cond_signal(&s->wake);
+    pthread_mutex_unlock(&s->lock);
+
+    pthread_join(s->thread, NULL);
+
+    devices_free(s->names, s->count);
+    devices_free(s->seen, s->seen_count);
+    pthread_cond_destroy(&s->wake);
+    pthread_mutex_destroy(&s->lock);
+
+    s->names = NULL;
+    s->count = 0;
+    s->seen = NULL;
+    s->seen_count = 0;
+    s->running = 0;
+}
@@ -0,0 +1,65 @@
+#ifndef DEVICE_SCAN
+#define DEVICE_SCAN
+
+#include <pthread.h>
+#include <stddef.h>
+
+// time between two scans of the capture devices
+#define DEVICE_RESCAN_NS 3000000000LL
+
+// the capture devices, rescanned on a thread as openal can take a while
+// to enumerate them (hundreds of ms with some servers)
+typedef struct device_scan
+{
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+
+    int running;
+    int stop;
+
+    // set by scan_request(), scans without waiting out the interval
+    int now;
+
+    // the devices as of the last scan
+    char** seen;
+    size_t seen_count;
+
+    // a copy of seen for scan_take(), NULL once taken, and a count of the
+    // scans that found a change
+    char** names;
+    size_t count;
+    unsigned long generation;
+} device_scan;
+
+// the capture device names, each one and the array malloc'd
+// returns the count, names is NULL when there are none
+size_t
+devices_enumerate(char*** names);
+
+void
+devices_free(char** names, size_t count);
+
+// starts scanning every DEVICE_RESCAN_NS, names / count being the list
+// the caller already has
+// returns 1 if the thread could not be started
+int
+scan_start(device_scan* s, char** names, size_t count);
+
+// scans as soon as possible
+void
+scan_request(device_scan* s);
+
+// hands over the last list if it is newer than *generation, the caller
+// then owns it
+// returns 1 if it did
+int
+scan_take(device_scan* s,
+          unsigned long* generation,
+          char*** names,
+          size_t* count);
+
+void
+scan_stop(device_scan* s);
+
+#endif
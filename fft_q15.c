@@ -0,0 +1,334 @@
+#include "fft_q15.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// float in -1..1 to q15, 1 is 32767
+static short
+to_q15(float x)
+{
+    return (short)lrintf(x * 32767.0f);
+}
+
+int
+q15_init(q15_fft* q, const fft_plan* plan)
+{
+    int n = (int)plan->N;
+
+    *q = (q15_fft){ 0 };
+    q->size = 2 * n;
+    q->plan = plan;
+    q->window_type = -1;
+
+    q->twiddle = malloc((n > 1 ? n - 1 : 1) * 2 * sizeof(short));
+    q->rtwiddle = malloc((n / 2 + 1) * 2 * sizeof(short));
+    q->window = malloc(q->size * sizeof(short));
+    q->frames = malloc(MAX_CHANNELS * q->size * sizeof(short));
+    q->planes = malloc(MAX_CHANNELS * q->size * sizeof(short));
+    q->frame = malloc(q->size * sizeof(short));
+    q->out = malloc(q->size * sizeof(int));
+
+    int failed = !q->twiddle || !q->rtwiddle || !q->window || !q->frames ||
+                 !q->planes || !q->frame || !q->out;
+
+    for (int c = 0; c < MAX_CHANNELS; c++) {
+        q->ring[c] = calloc(2 * q->size, sizeof(short));
+        failed |= !q->ring[c];
+    }
+
+    if (failed) {
+        q15_free(q);
+        return 1;
+    }
+
+    for (int i = 0; i < 2 * (n - 1); i++)
+        q->twiddle[i] = to_q15(plan->twiddle[i]);
+
+    for (int i = 0; i < 2 * (n / 2 + 1); i++)
+        q->rtwiddle[i] = to_q15(plan->rtwiddle[i]);
+
+    return 0;
+}
+
+void
+q15_free(q15_fft* q)
+{
+    free(q->twiddle);
+    free(q->rtwiddle);
+    free(q->window);
+    free(q->frames);
+    free(q->planes);
+    free(q->frame);
+    free(q->out);
+    for (int c = 0; c < MAX_CHANNELS; c++)
+        free(q->ring[c]);
+
+    *q = (q15_fft){ 0 };
+}
+
+void
+q15_set_window(q15_fft* q, const stft* st)
+{
+    if (st->window_type == q->window_type)
+        return;
+
+    // the table is scaled to a mean of 1, so its peak is over 1
+    float peak = 0;
+    for (int i = 0; i < q->size; i++)
+        peak = st->window[i] > peak ? st->window[i] : peak;
+
+    for (int i = 0; i < q->size; i++)
+        q->window[i] = to_q15(st->window[i] / peak);
+
+    q->window_peak = peak;
+    q->window_type = st->window_type;
+}
+
+void
+q15_ingest_u8(short* restrict out, const unsigned char* restrict in, int n)
+{
+    for (int i = 0; i < n; i++)
+        out[i] = (short)(((int)in[i] - 128) * 256);
+}
+
+void
+q15_split(short* restrict l,
+          short* restrict r,
+          const short* restrict x,
+          int n)
+{
+    for (int i = 0; i < n; i++) {
+        l[i] = x[2 * i];
+        r[i] = x[2 * i + 1];
+    }
+}
+
+void
+q15_mix(short* restrict out, const short* restrict x, int n, int side)
+{
+    for (int i = 0; i < n; i++)
+        out[i] = (short)((x[2 * i] + side * x[2 * i + 1]) >> 1);
+}
+
+void
+q15_clear(q15_fft* q)
+{
+    for (int c = 0; c < MAX_CHANNELS; c++) {
+        memset(q->ring[c], 0, 2 * q->size * sizeof(short));
+        q->pos[c] = 0;
+    }
+}
+
+void
+q15_push(q15_fft* q, int c, const short* samples, int n)
+{
+    short* ring = q->ring[c];
+    int size = q->size;
+    int pos = q->pos[c];
+
+    int first = size - pos;
+    if (first > n)
+        first = n;
+
+    memcpy(ring + pos, samples, first * sizeof(short));
+    memcpy(ring + pos + size, samples, first * sizeof(short));
+
+    if (n > first) {
+        memcpy(ring, samples + first, (n - first) * sizeof(short));
+        memcpy(ring + size, samples + first, (n - first) * sizeof(short));
+    }
+
+    q->pos[c] = (pos + n) % size;
+}
+
+// largest magnitude of n values
+static int
+block_max(const short* x, int n)
+{
+    int max = 0;
+
+    for (int i = 0; i < n; i++) {
+        int v = x[i] < 0 ? -x[i] : x[i];
+        max = v > max ? v : max;
+    }
+
+    return max;
+}
+
+// windows the history shifted left by up into frame, returns the largest
+// magnitude
+static int
+window_frame(short* restrict frame,
+             const short* restrict in,
+             const short* restrict window,
+             int n,
+             int up)
+{
+    int max = 0;
+
+    for (int i = 0; i < n; i++) {
+        int v = ((in[i] << up) * window[i] + (1 << 14)) >> 15;
+        frame[i] = (short)v;
+
+        v = v < 0 ? -v : v;
+        max = v > max ? v : max;
+    }
+
+    return max;
+}
+
+// shifts the block right until max fits the headroom, returns the shift
+static int
+normalize(short* x, int n, int max)
+{
+    int shift = 0;
+    while ((max >> shift) > Q15_HEADROOM)
+        shift++;
+
+    if (shift == 0)
+        return 0;
+
+    for (int i = 0; i < n; i++)
+        x[i] = (short)(x[i] >> shift);
+
+    return shift;
+}
+
+// the forward cfft of cfft_plan() on n complex q15 values, scaled down by
+// 2^shifts instead of 1 / 2n, returns the shifts
+static int
+cfft_q15(q15_fft* q, short* x, int max)
+{
+    const fft_plan* plan = q->plan;
+    long n = plan->N;
+    int exponent = 0;
+
+    // bit reversal
+    for (long i = 0; i < plan->nswaps; i++) {
+        long a = (long)plan->swaps[2 * i] << 1;
+        long b = (long)plan->swaps[2 * i + 1] << 1;
+        short re = x[b];
+        short im = x[b + 1];
+        x[b] = x[a];
+        x[b + 1] = x[a + 1];
+        x[a] = re;
+        x[a + 1] = im;
+    }
+
+    // L complex values per half block
+    for (long L = 1; L < n; L <<= 1) {
+        if (L > 1)
+            max = block_max(x, 2 * n);
+        exponent += normalize(x, 2 * n, max);
+
+        const short* tw = q->twiddle + 2 * (L - 1);
+
+        for (long b = 0; b < 2 * n; b += 4 * L) {
+            short* xa = x + b;
+            short* xb = xa + 2 * L;
+
+            for (long k = 0; k < L; k++) {
+                int wr = tw[2 * k];
+                int wi = tw[2 * k + 1];
+                int br = xb[2 * k];
+                int bi = xb[2 * k + 1];
+                int re = (wr * br - wi * bi + (1 << 14)) >> 15;
+                int im = (wr * bi + wi * br + (1 << 14)) >> 15;
+
+                xb[2 * k] = (short)(xa[2 * k] - re);
+                xb[2 * k + 1] = (short)(xa[2 * k + 1] - im);
+                xa[2 * k] = (short)(xa[2 * k] + re);
+                xa[2 * k + 1] = (short)(xa[2 * k + 1] + im);
+            }
+        }
+    }
+
+    return exponent;
+}
+
+// q15 twiddle times a value of up to 2 * 32768, the product fits an int
+static inline int
+mul_q15(int w, int x)
+{
+    return (w * x) >> 15;
+}
+
+void
+q15_rfft(q15_fft* q, int c)
+{
+    long n = q->plan->N;
+    short* x = q->frame;
+    int* out = q->out;
+
+    const short* in = q->ring[c] + q->pos[c];
+
+    // quiet input is scaled up to the full 16 bits first, so the rounding
+    // of the stages stays small next to it
+    int up = 0;
+    int peak = block_max(in, q->size);
+    while (peak > 0 && (peak << (up + 1)) <= 32767)
+        up++;
+
+    int max = window_frame(x, in, q->window, q->size, up);
+    q->exponent = cfft_q15(q, x, max) - up;
+
+    // the split of rfft_plan() in integers, without its halving: the
+    // output is twice the float one times 2^exponent
+    for (long i = 0; i <= n >> 1; i++) {
+        long i1 = i << 1;
+        long i2 = i1 + 1;
+        long i3 = 2 * n - i1;
+        long i4 = i3 + 1;
+
+        // bin 0 pairs with itself, it is dc and nyquist
+        int ar = x[i1];
+        int ai = x[i2];
+        int br = i == 0 ? ar : x[i3];
+        int bi = i == 0 ? ai : x[i4];
+
+        int wr = q->rtwiddle[i1];
+        int wi = q->rtwiddle[i2];
+
+        int h1r = ar + br;
+        int h1i = ai - bi;
+        int h2r = ai + bi;
+        int h2i = br - ar;
+
+        int tr = mul_q15(wr, h2r) - mul_q15(wi, h2i);
+        int ti = mul_q15(wr, h2i) + mul_q15(wi, h2r);
+
+        if (i == 0) {
+            out[0] = h1r + tr;
+            out[1] = h1r - tr;
+            continue;
+        }
+
+        out[i1] = h1r + tr;
+        out[i2] = h1i + ti;
+        out[i3] = h1r - tr;
+        out[i4] = -h1i + ti;
+    }
+}
+
+float
+q15_scale(const q15_fft* q, float gain)
+{
+    // the samples were over 32768 and the window over its peak, the float
+    // cfft scales by 1 / size and the split halves
+    return ldexpf(gain * q->window_peak / (32768.0f * q->size),
+                  q->exponent - 1);
+}
+
+void
+q15_power(const int* restrict x,
+          const float* restrict tilt,
+          float* restrict power,
+          int bins,
+          float scale)
+{
+    for (int k = 0; k < bins; k++) {
+        float re = x[2 * k] * scale * tilt[2 * k];
+        float im = x[2 * k + 1] * scale * tilt[2 * k + 1];
+        power[k] = re * re + im * im;
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef FFT_Q15
+#define FFT_Q15
+
+#include "chuck_fft.h"
+#include "spectrum.h"
+#include "stft.h"
+
+// fixed point analysis of integer samples, for cpus without a fast fpu
+//
+// the samples stay 16 bit integers from the capture to the last fft stage:
+// a q15 history and window per spectrum, then a radix-2 fft with block
+// floating point scaling, each stage shifts the whole block right just
+// enough that its butterflies cannot overflow and counts the shifts in a
+// shared exponent. only the bin powers go to float, scaled back by the
+// exponent so they match the float path
+
+// the largest value going into a stage, a butterfly grows a value by at
+// most 1 + sqrt(2) and (1 + sqrt(2)) * 13572 < 32768
+#define Q15_HEADROOM 13572
+
+typedef struct q15_fft
+{
+    // real samples per fft
+    int size;
+
+    // the size / 2 point float plan of the same fft, for its bit reversal
+    const fft_plan* plan;
+
+    // q15 copies of the plan's cfft and rfft twiddles
+    short* twiddle;
+    short* rtwiddle;
+
+    // the window over its peak in q15, the peak scales the output back
+    short* window;
+    float window_peak;
+    window_type window_type;
+
+    // sample history per spectrum, written at pos and pos + size like
+    // stft's
+    short* ring[MAX_CHANNELS];
+    int pos[MAX_CHANNELS];
+
+    // a hop of interleaved samples and a plane per spectrum,
+    // MAX_CHANNELS * size values each
+    short* frames;
+    short* planes;
+
+    // the windowed frame, then the cfft of it in place
+    short* frame;
+
+    // the rfft, size values laid out like rfft_plan()'s
+    int* out;
+
+    // right shifts of the last fft
+    int exponent;
+} q15_fft;
+
+// allocates the tables for the rfft of plan->N * 2 samples with a silent
+// history, the plan must outlive q
+// returns 1 on failure
+int
+q15_init(q15_fft* q, const fft_plan* plan);
+
+void
+q15_free(q15_fft* q);
+
+// the window of st in q15 if its type changed
+void
+q15_set_window(q15_fft* q, const stft* st);
+
+// samples to q15, full scale of either format comes out as +-32768
+
+// (in - 128) * 256
+void
+q15_ingest_u8(short* out, const unsigned char* in, int n);
+
+// n stereo frames of x to a plane per channel
+void
+q15_split(short* l, short* r, const short* x, int n);
+
+// n stereo frames of x to (l + side * r) / 2
+void
+q15_mix(short* out, const short* x, int n, int side);
+
+// every spectrum back to a silent history
+void
+q15_clear(q15_fft* q);
+
+// appends n samples to the history of spectrum c, n <= size
+void
+q15_push(q15_fft* q, int c, const short* samples, int n);
+
+// rfft of the windowed history of spectrum c into q->out, sets
+// q->exponent
+void
+q15_rfft(q15_fft* q, int c);
+
+// what q->out is multiplied by to match rfft_plan() on the float samples
+// times gain
+float
+q15_scale(const q15_fft* q, float gain);
+
+// tilted power of `bins` complex values of x, each value times scale
+void
+q15_power(const int* x,
+          const float* tilt,
+          float* power,
+          int bins,
+          float scale);
+
+#endif
@@ -0,0 +1,200 @@
+#include "fft_simd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FFT_SIMD_X86
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+void
+fft_radix4_first_pass(float* x, long N, unsigned int forward)
+{
+    // multiplying by +i (forward) or -i (inverse)
+    float s = forward ? 1.0f : -1.0f;
+
+    for (long i = 0; i < N * 2; i += 8) {
+        float* c = x + i;
+
+        // L = 1
+        float ar = c[0] + c[2], ai = c[1] + c[3];
+        float br = c[0] - c[2], bi = c[1] - c[3];
+        float cr = c[4] + c[6], ci = c[5] + c[7];
+        float dr = c[4] - c[6], di = c[5] - c[7];
+
+        // L = 2, w = 1 for (a, c) and w = +-i for (b, d)
+        float wdr = -s * di, wdi = s * dr;
+
+        c[0] = ar + cr;
+        c[1] = ai + ci;
+        c[4] = ar - cr;
+        c[5] = ai - ci;
+        c[2] = br + wdr;
+        c[3] = bi + wdi;
+        c[6] = br - wdr;
+        c[7] = bi - wdi;
+    }
+}
+
+#ifdef FFT_SIMD_X86
+
+int
+fft_cpu_has_sse2(void)
+{
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d))
+        return 0;
+    return (d & bit_SSE2) != 0;
+}
+
+int
+fft_cpu_has_avx2(void)
+{
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d))
+        return 0;
+
+    if (!(c & bit_OSXSAVE) || !(c & bit_AVX))
+        return 0;
+
+    // the os has to save the ymm registers on context switches
+    unsigned int xcr0_lo, xcr0_hi;
+    __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 6) != 6)
+        return 0;
+
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d))
+        return 0;
+    return (b & bit_AVX2) != 0;
+}
+
+__attribute__((target("sse2"))) void
+fft_stages_sse2(float* x,
+                long N,
+                const float* twiddle,
+                unsigned int forward,
+                float scale)
+{
+    long ND = N << 1;
+
+    // conjugates the forward twiddles for the inverse transform
+    __m128 conj =
+      forward ? _mm_setzero_ps() : _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+    // negates the real lanes
+    __m128 neg_re = _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f);
+
+    for (long L = 4; L < N; L <<= 1) {
+        long delta = L << 2;
+        const float* tw = twiddle + 2 * (L - 1);
+
+        for (long blk = 0; blk < ND; blk += delta) {
+            float* xa = x + blk;
+            float* xb = xa + (L << 1);
+
+            for (long k = 0; k < L * 2; k += 4) {
+                __m128 w = _mm_xor_ps(_mm_loadu_ps(tw + k), conj);
+                __m128 wr = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+                __m128 wi = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1));
+
+                __m128 a = _mm_loadu_ps(xa + k);
+                __m128 b = _mm_loadu_ps(xb + k);
+                __m128 bs = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1));
+
+                // (br*wr - bi*wi, bi*wr + br*wi)
+                __m128 t = _mm_add_ps(_mm_mul_ps(b, wr),
+                                      _mm_xor_ps(_mm_mul_ps(bs, wi), neg_re));
+
+                _mm_storeu_ps(xb + k, _mm_sub_ps(a, t));
+                _mm_storeu_ps(xa + k, _mm_add_ps(a, t));
+            }
+        }
+    }
+
+    __m128 vscale = _mm_set1_ps(scale);
+    for (long i = 0; i < ND; i += 4)
+        _mm_storeu_ps(x + i, _mm_mul_ps(_mm_loadu_ps(x + i), vscale));
+}
+
+__attribute__((target("avx2"))) void
+fft_stages_avx2(float* x,
+                long N,
+                const float* twiddle,
+                unsigned int forward,
+                float scale)
+{
+    long ND = N << 1;
+
+    __m256 conj = forward ? _mm256_setzero_ps()
+                          : _mm256_set_ps(-0.0f,
+                                          0.0f,
+                                          -0.0f,
+                                          0.0f,
+                                          -0.0f,
+                                          0.0f,
+                                          -0.0f,
+                                          0.0f);
+
+    for (long L = 4; L < N; L <<= 1) {
+        long delta = L << 2;
+        const float* tw = twiddle + 2 * (L - 1);
+
+        for (long blk = 0; blk < ND; blk += delta) {
+            float* xa = x + blk;
+            float* xb = xa + (L << 1);
+
+            for (long k = 0; k < L * 2; k += 8) {
+                __m256 w = _mm256_xor_ps(_mm256_loadu_ps(tw + k), conj);
+                __m256 wr = _mm256_permute_ps(w, _MM_SHUFFLE(2, 2, 0, 0));
+                __m256 wi = _mm256_permute_ps(w, _MM_SHUFFLE(3, 3, 1, 1));
+
+                __m256 a = _mm256_loadu_ps(xa + k);
+                __m256 b = _mm256_loadu_ps(xb + k);
+                __m256 bs = _mm256_permute_ps(b, _MM_SHUFFLE(2, 3, 0, 1));
+
+                // addsub: (br*wr - bi*wi, bi*wr + br*wi)
+                __m256 t = _mm256_addsub_ps(_mm256_mul_ps(b, wr),
+                                            _mm256_mul_ps(bs, wi));
+
+                _mm256_storeu_ps(xb + k, _mm256_sub_ps(a, t));
+                _mm256_storeu_ps(xa + k, _mm256_add_ps(a, t));
+            }
+        }
+    }
+
+    __m256 vscale = _mm256_set1_ps(scale);
+    for (long i = 0; i < ND; i += 8)
+        _mm256_storeu_ps(x + i, _mm256_mul_ps(_mm256_loadu_ps(x + i), vscale));
+}
+
+#else
+
+int
+fft_cpu_has_sse2(void)
+{
+    return 0;
+}
+
+int
+fft_cpu_has_avx2(void)
+{
+    return 0;
+}
+
+void
+fft_stages_sse2(float* x,
+                long N,
+                const float* twiddle,
+                unsigned int forward,
+                float scale)
+{
+}
+
+void
+fft_stages_avx2(float* x,
+                long N,
+                const float* twiddle,
+                unsigned int forward,
+                float scale)
+{
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef FFT_SIMD
+#define FFT_SIMD
+
+// vectorized cfft butterflies, used by cfft_plan() through fft_set_kernel()
+//
+// they run the radix-2 stages with L >= 4 complex values per half block
+// (after fft_radix4_first_pass() did L = 1 and L = 2) and scale the output,
+// the arithmetic per butterfly is the same as the scalar loop, see
+// FFT_KERNEL_TOLERANCE for how close the output is
+
+int
+fft_cpu_has_sse2(void);
+
+int
+fft_cpu_has_avx2(void);
+
+// combined first two radix-2 stages, twiddles are exactly 1 and +-i
+void
+fft_radix4_first_pass(float* x, long N, unsigned int forward);
+
+void
+fft_stages_sse2(float* x,
+                long N,
+                const float* twiddle,
+                unsigned int forward,
+                float scale);
+
+void
+fft_stages_avx2(float* x,
+                long N,
+                const float* twiddle,
+                unsigned int forward,
+                float scale);
+
+#endif
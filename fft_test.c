@@ -0,0 +1,125 @@
+// checks the simd fft kernels against the scalar one, `make fft-test`
+//
+// the kernel under test is the one AUVI_FFT_KERNEL picks (scalar, sse2 or
+// avx2), it runs cfft_plan() and rfft_plan() both ways at every plan size
+// on the same inputs as the scalar kernel, and every output has to be
+// within FFT_KERNEL_TOLERANCE * max|X| of the scalar one
+//
+// usage: AUVI_FFT_KERNEL=sse2 fft_test, exits 1 on the first mismatch, 0
+// without checking anything if the cpu does not have the kernel
+
+#include "chuck_fft.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// the same pseudo random input for every kernel, in -1..1
+static void
+fill(float* x, long n, uint32_t seed)
+{
+    for (long i = 0; i < n; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        x[i] = (float)(seed >> 8) / (float)(1 << 23) - 1.0f;
+    }
+}
+
+// runs one transform of 2 * plan->N floats on kernel k
+static void
+transform(fft_plan* plan, float* x, int real, unsigned int forward, int k)
+{
+    fft_set_kernel((fft_kernel)k);
+
+    if (real)
+        rfft_plan(plan, x, forward);
+    else
+        cfft_plan(plan, x, forward);
+}
+
+// 0 if the kernel's output is within the tolerance of the scalar one
+static int
+check(fft_plan* plan,
+      float* want,
+      float* got,
+      int real,
+      unsigned int forward,
+      fft_kernel k)
+{
+    long n = 2 * plan->N;
+
+    fill(want, n, (uint32_t)plan->N * 4 + real * 2 + forward);
+    memcpy(got, want, n * sizeof(float));
+
+    transform(plan, want, real, forward, FFT_KERNEL_SCALAR);
+    transform(plan, got, real, forward, k);
+
+    double peak = 0;
+    double worst = 0;
+
+    for (long i = 0; i < n; i++) {
+        peak = fmax(peak, fabs(want[i]));
+        worst = fmax(worst, fabs((double)got[i] - want[i]));
+    }
+
+    if (worst <= FFT_KERNEL_TOLERANCE * peak)
+        return 0;
+
+    printf("%s %s %s, %ld values: max error %g of max |X| %g\n",
+           fft_kernel_name(k),
+           real ? "rfft" : "cfft",
+           forward ? "forward" : "inverse",
+           n,
+           worst,
+           peak);
+    return 1;
+}
+
+int
+main(void)
+{
+    const char* name = getenv("AUVI_FFT_KERNEL");
+
+    fft_select_kernel();
+    fft_kernel k = fft_get_kernel();
+
+    if (name != NULL && strcmp(name, fft_kernel_name(k)) != 0) {
+        printf("%s: not supported by the cpu, skipped\n", name);
+        return 0;
+    }
+
+    float* want = malloc(2 * FFT_PLAN_MAX_SIZE * sizeof(float));
+    float* got = malloc(2 * FFT_PLAN_MAX_SIZE * sizeof(float));
+    if (want == NULL || got == NULL) {
+        printf("could not allocate buffers\n");
+        return 1;
+    }
+
+    int failed = 0;
+    int sizes = 0;
+
+    for (long N = 1; N <= FFT_PLAN_MAX_SIZE && !failed; N <<= 1) {
+        fft_plan* plan = fft_plan_create(N);
+        if (plan == NULL) {
+            printf("could not create a plan for %ld values\n", N);
+            failed = 1;
+            break;
+        }
+
+        for (int real = 0; real <= 1 && !failed; real++)
+            for (unsigned int forward = 0; forward <= 1 && !failed; forward++)
+                failed = check(plan, want, got, real, forward, k);
+
+        fft_plan_destroy(plan);
+        sizes++;
+    }
+
+    free(want);
+    free(got);
+
+    printf("%s: %s, %d sizes\n",
+           fft_kernel_name(k),
+           failed ? "failed" : "ok",
+           sizes);
+    return failed;
+}
@@ -0,0 +1,182 @@
+#include "filter.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+
+// the public functions switch on n so the loops of the common sizes are
+// compiled with a constant trip count
+#define FIXED_SIZE_CASES(n, call)                                              \
+    switch (n) {                                                               \
+        case 256:                                                              \
+            call(256);                                                         \
+            break;                                                             \
+        case 512:                                                              \
+            call(512);                                                         \
+            break;                                                             \
+        case 1024:                                                             \
+            call(1024);                                                        \
+            break;                                                             \
+        case 2048:                                                             \
+            call(2048);                                                        \
+            break;                                                             \
+        default:                                                               \
+            call(n);                                                           \
+            break;                                                             \
+    }
+
+static inline __attribute__((always_inline)) void
+exponential_smoothing(float* fft, float* tmp, int n, float alpha)
+{
+    tmp[0] = fft[0];
+    for (int i = 1; i < n; i++) {
+        tmp[i] = alpha * fft[i] + (1.0f - alpha) * tmp[i - 1];
+    }
+
+    fft[n - 1] = tmp[n - 1];
+    for (int i = n - 2; i >= 0; i--) {
+        fft[i] = alpha * tmp[i] + (1.0f - alpha) * fft[i + 1];
+    }
+}
+
+void
+apply_exponential_smoothing(float* fft, float* tmp, int n, float alpha)
+{
+#define CALL(size) exponential_smoothing(fft, tmp, size, alpha)
+    FIXED_SIZE_CASES(n, CALL)
+#undef CALL
+}
+
+// P[m] = sum of the first m bins, m = 0..n
+static inline __attribute__((always_inline)) void
+prefix_sums(const float* fft, double* P, int n)
+{
+    P[0] = 0;
+    for (int i = 0; i < n; i++)
+        P[i + 1] = P[i] + fft[i];
+}
+
+// sum of P[clamp(m, 0, n)] for m = a..b, with Q[t] = sum of P[0..t-1]
+static inline double
+clamped_prefix_sum(const double* P,
+                   const double* Q,
+                   int n,
+                   long long a,
+                   long long b)
+{
+    long long lo = a > 0 ? a : 0;
+    long long hi = b < n ? b : n;
+
+    double sum = lo <= hi ? Q[hi + 1] - Q[lo] : 0;
+
+    // indices past n all read P[n], the ones below 0 read P[0] = 0
+    long long above = b - (a > n + 1 ? a : n + 1) + 1;
+    if (above > 0)
+        sum += above * P[n];
+
+    return sum;
+}
+
+// sum of clamp(m, 0, n) for m = a..b
+static inline double
+clamped_index_sum(int n, long long a, long long b)
+{
+    long long lo = a > 0 ? a : 0;
+    long long hi = b < n ? b : n;
+
+    double sum = lo <= hi ? (double)(lo + hi) * (hi - lo + 1) / 2 : 0;
+
+    long long above = b - (a > n + 1 ? a : n + 1) + 1;
+    if (above > 0)
+        sum += (double)above * n;
+
+    return sum;
+}
+
+// the triangular weights r - |i - j| are a box of r bins convolved with
+// itself, so both the weighted sum and the sum of the weights are a
+// difference of box sums over the prefix sums P, which makes them two
+// lookups into the prefix sums of P (Q) whatever the range
+//
+// bins outside 0..n-1 contribute neither value nor weight, like the
+// truncated loop did
+static inline __attribute__((always_inline)) void
+weighted_filter(float* fft, double* sums, int n, int filter_range)
+{
+    double* P = sums;
+    double* Q = sums + n + 1;
+    long long r = filter_range;
+
+    prefix_sums(fft, P, n);
+
+    Q[0] = 0;
+    for (int i = 0; i <= n; i++)
+        Q[i + 1] = Q[i] + P[i];
+
+    for (int i = 0; i < n; i++) {
+        double sum = clamped_prefix_sum(P, Q, n, i + 1, i + r) -
+                     clamped_prefix_sum(P, Q, n, i - r + 1, i);
+        double weight_sum = clamped_index_sum(n, i + 1, i + r) -
+                            clamped_index_sum(n, i - r + 1, i);
+
+        fft[i] = (float)(sum / weight_sum);
+    }
+}
+
+void
+apply_weighted_filter(float* fft, double* sums, int n, int filter_range)
+{
+    // a zero range would weigh everything by 1 - 0/0
+    if (filter_range <= 0)
+        return;
+
+#define CALL(size) weighted_filter(fft, sums, size, filter_range)
+    FIXED_SIZE_CASES(n, CALL)
+#undef CALL
+}
+
+static inline __attribute__((always_inline)) void
+box_filter(float* fft, double* sums, int n, int filter_range)
+{
+    double* P = sums;
+    long long r = filter_range;
+
+    prefix_sums(fft, P, n);
+
+    for (int i = 0; i < n; i++) {
+        long long start = i - r < 0 ? 0 : i - r;
+        long long end = i + r > n - 1 ? n - 1 : i + r;
+
+        fft[i] = (float)((P[end + 1] - P[start]) / ((end - start) + 1));
+    }
+}
+
+void
+apply_box_filter(float* fft, double* sums, int n, int filter_range)
+{
+    if (filter_range <= 0)
+        return;
+
+#define CALL(size) box_filter(fft, sums, size, filter_range)
+    FIXED_SIZE_CASES(n, CALL)
+#undef CALL
+}
+
+void
+apply_block_filter(float* fft, int n, int filter_range)
+{
+    if (filter_range <= 0)
+        return;
+
+    for (int i = 0; i < n; i += filter_range) {
+        float sum = 0;
+        for (int j = i; j < min(i + filter_range, n); j++) {
+            sum += fft[j];
+        }
+
+        float avg = sum / filter_range;
+
+        for (int j = i; j < min(i + filter_range, n); j++) {
+            fft[j] = avg;
+        }
+    }
+}
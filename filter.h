@@ -0,0 +1,25 @@
+#ifndef FILTER
+#define FILTER
+
+// smoothing filters over n display bins
+//
+// `tmp` is scratch space of at least n floats, `sums` of at least
+// FILTER_SUMS_SIZE(n) doubles for the running sums
+
+#define FILTER_SUMS_SIZE(n) (2 * (n) + 3)
+
+void
+apply_exponential_smoothing(float* fft, float* tmp, int n, float alpha);
+
+// O(n) whatever the range, a range <= 0 leaves the bins unchanged
+void
+apply_weighted_filter(float* fft, double* sums, int n, int filter_range);
+
+// O(n) whatever the range, a range <= 0 leaves the bins unchanged
+void
+apply_box_filter(float* fft, double* sums, int n, int filter_range);
+
+void
+apply_block_filter(float* fft, int n, int filter_range);
+
+#endif
@@ -0,0 +1,134 @@
+#include "generator.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define GEN_AMP 0.5f
+
+int
+gen_init(generator* g, const char* spec, int sample_rate)
+{
+    char name[16] = { 0 };
+    double args[3] = { -1, -1, -1 };
+
+    sscanf(spec, "%15[^:]:%lf:%lf:%lf", name, &args[0], &args[1], &args[2]);
+
+    g->sample_rate = sample_rate;
+    g->phase = 0;
+    g->n = 0;
+    g->rng = 0x9e3779b9u;
+    memset(g->pink, 0, sizeof(g->pink));
+
+    double nyquist = sample_rate / 2.0;
+
+    if (strcmp(name, "sine") == 0) {
+        g->type = GenSine;
+        g->freq = args[0] < 0 ? 440 : args[0];
+        return g->freq <= 0 || g->freq >= nyquist;
+    }
+
+    if (strcmp(name, "sweep") == 0) {
+        g->type = GenSweep;
+        g->freq = args[0] < 0 ? 20 : args[0];
+        g->freq_end = args[1] < 0 ? nyquist : args[1];
+        g->seconds = args[2] < 0 ? 10 : args[2];
+        return g->freq <= 0 || g->freq_end <= 0 || g->freq > nyquist ||
+               g->freq_end > nyquist || g->seconds <= 0;
+    }
+
+    if (strcmp(name, "white") == 0) {
+        g->type = GenWhite;
+        return 0;
+    }
+
+    if (strcmp(name, "pink") == 0) {
+        g->type = GenPink;
+        return 0;
+    }
+
+    if (strcmp(name, "impulse") == 0) {
+        g->type = GenImpulse;
+        g->freq = args[0] < 0 ? 1 : args[0];
+        return g->freq <= 0 || g->freq > sample_rate;
+    }
+
+    return 1;
+}
+
+// uniform in -1..1
+static float
+white(generator* g)
+{
+    // xorshift32
+    unsigned int x = g->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    g->rng = x;
+
+    return (float)((int)x) * (1.0f / 2147483648.0f);
+}
+
+// paul kellet's refined pink filter, white noise through 7 first order
+// sections, scaled by 0.11 to stay about within -1..1
+static float
+pink(generator* g)
+{
+    float w = white(g);
+    float* b = g->pink;
+
+    b[0] = 0.99886f * b[0] + w * 0.0555179f;
+    b[1] = 0.99332f * b[1] + w * 0.0750759f;
+    b[2] = 0.96900f * b[2] + w * 0.1538520f;
+    b[3] = 0.86650f * b[3] + w * 0.3104856f;
+    b[4] = 0.55000f * b[4] + w * 0.5329522f;
+    b[5] = -0.7616f * b[5] - w * 0.0168980f;
+
+    float out = b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6] + w * 0.5362f;
+    b[6] = w * 0.115926f;
+
+    return out * 0.11f;
+}
+
+void
+gen_fill(generator* g, float* out, int n)
+{
+    double rate = g->sample_rate;
+
+    for (int i = 0; i < n; i++, g->n++) {
+        float v = 0;
+
+        switch (g->type) {
+            case GenSine:
+                v = (float)sin(g->phase);
+                g->phase += 2 * M_PI * g->freq / rate;
+                break;
+            case GenSweep: {
+                double t = fmod(g->n / rate, g->seconds) / g->seconds;
+                double f = g->freq * pow(g->freq_end / g->freq, t);
+
+                v = (float)sin(g->phase);
+                g->phase += 2 * M_PI * f / rate;
+                break;
+            }
+            case GenWhite:
+                v = white(g);
+                break;
+            case GenPink:
+                v = pink(g);
+                break;
+            case GenImpulse: {
+                // one sample per period, the period rounded to samples
+                long long period = (long long)(rate / g->freq + 0.5);
+                v = g->n % period == 0 ? 1.0f : 0.0f;
+                break;
+            }
+        }
+
+        // keep the phase small so it stays exact over long runs
+        if (g->phase > 2 * M_PI)
+            g->phase -= 2 * M_PI;
+
+        out[i] = v * GEN_AMP;
+    }
+}
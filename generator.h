@@ -0,0 +1,51 @@
+#ifndef GENERATOR
+#define GENERATOR
+
+// synthetic test signals, float samples at half of full scale
+
+typedef enum gen_type
+{
+    // sine:FREQ
+    GenSine = 0,
+
+    // sweep:FROM:TO:SECONDS, exponential and repeating
+    GenSweep = 1,
+
+    GenWhite = 2,
+
+    // white noise through a -3 dB / octave filter
+    GenPink = 3,
+
+    // impulse:PER_SECOND
+    GenImpulse = 4
+} gen_type;
+
+typedef struct generator
+{
+    gen_type type;
+    int sample_rate;
+
+    // frequency (the start one of a sweep), sweep end and length, impulses
+    // per second
+    double freq;
+    double freq_end;
+    double seconds;
+
+    double phase;
+    long long n;
+
+    // noise state
+    unsigned int rng;
+    float pink[7];
+} generator;
+
+// parses a spec like "sine:440" or "sweep:20:20000:10", missing numbers
+// take defaults
+// returns 1 on an unknown signal or out of range numbers
+int
+gen_init(generator* g, const char* spec, int sample_rate);
+
+void
+gen_fill(generator* g, float* out, int n);
+
+#endif
@@ -0,0 +1,155 @@
+#include "goertzel.h"
+#include "chuck_fft.h"
+#include <math.h>
+#include <stdlib.h>
+
+// the distinct bins of map in order, out == NULL only counts them
+// returns -1 on failure
+static int
+map_bins(const band_map* map, int* out)
+{
+    unsigned char* read = calloc(map->bin_end, 1);
+    if (!read)
+        return -1;
+
+    for (int b = 0; b < map->count; b++)
+        for (int j = 0; j < map->len[b]; j++)
+            read[map->first[b] + j] = 1;
+
+    int count = 0;
+    for (int k = map->bin_start; k < map->bin_end; k++) {
+        if (read[k] && out)
+            out[count] = k;
+        count += read[k];
+    }
+
+    free(read);
+    return count;
+}
+
+int
+goertzel_cheaper(const band_map* map, int fft_size)
+{
+    if (map->bin_start == 0)
+        return 0;
+
+    int bins = map_bins(map, NULL);
+    if (bins < 0)
+        return 0;
+
+    const double stage[] = GOERTZEL_STAGE_COSTS;
+    int groups = (bins + GOERTZEL_LANES - 1) / GOERTZEL_LANES;
+
+    return groups * GOERTZEL_GROUP_COST <=
+           stage[fft_get_kernel()] * log2((double)fft_size);
+}
+
+int
+goertzel_init(goertzel_bank* g, const band_map* map, int fft_size)
+{
+    *g = (goertzel_bank){ 0 };
+
+    int count = map_bins(map, NULL);
+    if (count < 0)
+        return 1;
+
+    int padded = (count + GOERTZEL_LANES - 1) / GOERTZEL_LANES * GOERTZEL_LANES;
+
+    g->bins = malloc(padded * sizeof(int));
+    g->coef = malloc(padded * sizeof(double));
+    g->cos = malloc(padded * sizeof(double));
+    g->sin = malloc(padded * sizeof(double));
+    g->s1 = malloc(padded * sizeof(double));
+    g->s2 = malloc(padded * sizeof(double));
+
+    if (!g->bins || !g->coef || !g->cos || !g->sin || !g->s1 || !g->s2) {
+        goertzel_free(g);
+        return 1;
+    }
+
+    if (map_bins(map, g->bins) < 0) {
+        goertzel_free(g);
+        return 1;
+    }
+
+    g->count = count;
+    g->padded = padded;
+
+    // the padding runs at dc and is never read
+    for (int j = 0; j < padded; j++) {
+        double w = j < count ? 2 * M_PI * g->bins[j] / fft_size : 0;
+
+        g->coef[j] = 2 * cos(w);
+        g->cos[j] = cos(w);
+        g->sin[j] = sin(w);
+    }
+
+    return 0;
+}
+
+void
+goertzel_free(goertzel_bank* g)
+{
+    free(g->bins);
+    free(g->coef);
+    free(g->cos);
+    free(g->sin);
+    free(g->s1);
+    free(g->s2);
+
+    *g = (goertzel_bank){ 0 };
+}
+
+// the filters of all bins over the n samples of x, GOERTZEL_LANES bins at
+// a time so their state stays in registers, a vector of bins per sample
+static void
+run(int m,
+    const double* restrict coef,
+    double* restrict s1,
+    double* restrict s2,
+    const float* restrict x,
+    int n)
+{
+    for (int g = 0; g < m; g += GOERTZEL_LANES) {
+        const double* c = coef + g;
+        double a[GOERTZEL_LANES] = { 0 };
+        double b[GOERTZEL_LANES] = { 0 };
+
+        for (int i = 0; i < n; i++) {
+            double v = x[i];
+
+            // v - b is off the chain from one sample to the next
+            for (int j = 0; j < GOERTZEL_LANES; j++) {
+                double s0 = c[j] * a[j] + (v - b[j]);
+                b[j] = a[j];
+                a[j] = s0;
+            }
+        }
+
+        for (int j = 0; j < GOERTZEL_LANES; j++) {
+            s1[g + j] = a[j];
+            s2[g + j] = b[j];
+        }
+    }
+}
+
+void
+goertzel_power(goertzel_bank* g,
+               const float* x,
+               int n,
+               const float* tilt,
+               float* power)
+{
+    run(g->padded, g->coef, g->s1, g->s2, x, n);
+
+    // one more step with a 0 sample, then the bin is s0 - e^-jw s1, scaled
+    // by 1 / n like the rfft
+    for (int j = 0; j < g->count; j++) {
+        int k = g->bins[j];
+        double s0 = g->coef[j] * g->s1[j] - g->s2[j];
+
+        float re = (float)((s0 - g->cos[j] * g->s1[j]) / n) * tilt[2 * k];
+        float im = (float)(g->sin[j] * g->s1[j] / n) * tilt[2 * k + 1];
+        power[k] = re * re + im * im;
+    }
+}
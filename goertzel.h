@@ -0,0 +1,62 @@
+#ifndef GOERTZEL
+#define GOERTZEL
+
+#include "bands.h"
+
+// targets run side by side, the bank is padded to a multiple of this so
+// the loop over them is whole vectors
+#define GOERTZEL_LANES 8
+
+// ns per sample of a group of GOERTZEL_LANES filters, and of a stage of
+// the rfft with the scalar, sse2 and avx2 kernels, medians of `make bench`
+// on an x86-64 desktop, only their ratios matter
+#define GOERTZEL_GROUP_COST 3.4
+#define GOERTZEL_STAGE_COSTS { 0.8, 0.5, 0.33 }
+
+// the dft bins a band map reads, each from its own goertzel filter
+//
+// a frame costs a multiply-add per sample and bin instead of the whole
+// rfft, so a few bands are cheaper this way. the filters run side by side
+// over the samples, a vector of bins per sample
+typedef struct goertzel_bank
+{
+    // bins, padded to a multiple of GOERTZEL_LANES
+    int count;
+    int padded;
+
+    // dft bin of each filter, and 2 cos, cos and sin of its frequency
+    int* bins;
+    double* coef;
+    double* cos;
+    double* sin;
+
+    // the last two outputs of each filter, in double since a low bin's
+    // coefficient is near 2 and float would lose it over a long frame
+    double* s1;
+    double* s2;
+} goertzel_bank;
+
+// 1 if a bank is cheaper than the rfft with the active kernel for the bins
+// map reads, maps that read bin 0 always take the rfft, which replaces it
+int
+goertzel_cheaper(const band_map* map, int fft_size);
+
+// builds the filters for the bins map reads out of an rfft of fft_size
+// returns 1 on failure, leaving the bank empty
+int
+goertzel_init(goertzel_bank* g, const band_map* map, int fft_size);
+
+void
+goertzel_free(goertzel_bank* g);
+
+// runs the filters over the n windowed samples of x and writes the
+// tilted power of their bins to power, like spectrum_power() on the rfft
+// of x
+void
+goertzel_power(goertzel_bank* g,
+               const float* x,
+               int n,
+               const float* tilt,
+               float* power);
+
+#endif
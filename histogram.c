@@ -0,0 +1,94 @@
+#include "histogram.h"
+#include <string.h>
+
+void
+hist_reset(histogram* h)
+{
+    memset(h, 0, sizeof(*h));
+}
+
+static int
+bucket_of(long long ns)
+{
+    if (ns < HIST_SUB_BUCKETS)
+        return ns < 0 ? 0 : (int)ns;
+
+    // the octave and the two bits under the leading one
+    int octave = 63 - __builtin_clzll((unsigned long long)ns);
+    int sub = (int)(ns >> (octave - 2)) & (HIST_SUB_BUCKETS - 1);
+    int idx = (octave - 1) * HIST_SUB_BUCKETS + sub;
+
+    return idx < HIST_BUCKETS ? idx : HIST_BUCKETS - 1;
+}
+
+// largest value that lands in bucket idx
+static long long
+bucket_upper(int idx)
+{
+    if (idx < HIST_SUB_BUCKETS)
+        return idx;
+
+    int octave = idx / HIST_SUB_BUCKETS + 1;
+    int sub = idx % HIST_SUB_BUCKETS;
+
+    return ((long long)(HIST_SUB_BUCKETS + sub + 1) << (octave - 2)) - 1;
+}
+
+void
+hist_record(histogram* h, long long ns)
+{
+    h->buckets[bucket_of(ns)]++;
+    h->count++;
+    h->sum += ns;
+
+    if (ns > h->max)
+        h->max = ns;
+}
+
+long long
+hist_percentile(const histogram* h, double p)
+{
+    if (h->count == 0)
+        return 0;
+
+    long long rank = (long long)(p * (h->count - 1)) + 1;
+    long long seen = 0;
+
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank)
+            return bucket_upper(i) < h->max ? bucket_upper(i) : h->max;
+    }
+
+    return h->max;
+}
+
+void
+hist_write_json(const histogram* h, FILE* file)
+{
+    fprintf(file,
+            "{ \"count\": %lld, \"mean_ns\": %lld, \"p50_ns\": %lld, "
+            "\"p90_ns\": %lld, \"p99_ns\": %lld, \"max_ns\": %lld, "
+            "\"buckets\": [",
+            h->count,
+            h->count ? h->sum / h->count : 0,
+            hist_percentile(h, 0.5),
+            hist_percentile(h, 0.9),
+            hist_percentile(h, 0.99),
+            h->max);
+
+    int first = 1;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        if (h->buckets[i] == 0)
+            continue;
+
+        fprintf(file,
+                "%s[%lld, %u]",
+                first ? "" : ", ",
+                bucket_upper(i),
+                h->buckets[i]);
+        first = 0;
+    }
+
+    fprintf(file, "] }");
+}
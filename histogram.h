@@ -0,0 +1,38 @@
+#ifndef HISTOGRAM
+#define HISTOGRAM
+
+#include <stdio.h>
+
+// fixed size log bucket histogram of durations in ns
+//
+// 4 buckets per power of 2, so a bucket spans at most 19% of its value,
+// up to 2^HIST_OCTAVES ns (about 18 minutes), recording never allocates
+
+#define HIST_SUB_BUCKETS 4
+#define HIST_OCTAVES 40
+#define HIST_BUCKETS (HIST_OCTAVES * HIST_SUB_BUCKETS)
+
+typedef struct histogram
+{
+    long long count;
+    long long sum;
+    long long max;
+    unsigned int buckets[HIST_BUCKETS];
+} histogram;
+
+void
+hist_reset(histogram* h);
+
+void
+hist_record(histogram* h, long long ns);
+
+// upper edge of the bucket holding the p-th (0..1) percentile, 0 if empty
+long long
+hist_percentile(const histogram* h, double p);
+
+// writes the histogram as a json object: count, mean, p50, p90, p99, max
+// in ns and the non empty buckets as [upper edge, count] pairs
+void
+hist_write_json(const histogram* h, FILE* file);
+
+#endif
@@ -45,6 +45,14 @@ ib_get_text_as_string(input_box* ib)
     return ib->text;
 }
 
+void
+ib_set_text(input_box* ib, char* text)
+{
+    strncpy(ib->text, text, MAX_TEXT_SIZE - 1);
+    ib->text[MAX_TEXT_SIZE - 1] = '\0';
+    ib->text_size = strlen(ib->text);
+}
+
 int
 ib_get_input(input_box* ib)
 {
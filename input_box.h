@@ -32,6 +32,10 @@ ib_get_text_as_float(input_box* ib);
 char*
 ib_get_text_as_string(input_box* ib);
 
+// replaces the text, truncating it to MAX_TEXT_SIZE - 1 chars
+void
+ib_set_text(input_box* ib, char* text);
+
 // if we get some input and modify the text
 // return 1 to indicate so, else 0
 int
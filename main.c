@@ -1,91 +1,209 @@
+#include "analyzer.h"
+#include "bars.h"
 #include "button.h"
+#include "capture.h"
 #include "chuck_fft.h"
+#include "device_scan.h"
+#include "histogram.h"
 #include "input_box.h"
+#include "output.h"
+#include "pipeline.h"
 #include "raylib.h"
+#include "rlgl.h"
 #include "slide_bar.h"
+#include "spectrum_shm.h"
 #include "string.h"
+#include "timing.h"
 #include "util.h"
+#include "waterfall.h"
 #include <math.h>
 #include <raylib.h>
+#include <getopt.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 
-#include "AL/al.h"
-#include "AL/alc.h"
+// give up on a frame after waiting this long for it, so a stalled device
+// does not freeze the window
+#define CAPTURE_TIMEOUT_NS 250000000LL
 
-#define SAMPLE_RATE 10000
-#define BUFFER_SIZE 256 // Number of samples
+// below this every bar is under a pixel on any sane window, so a frame
+// with all bands below it looks like silence
+#define IDLE_EPSILON 1e-3f
 
-typedef enum filter_type
+// redraw interval while idle, keeps the debug menu current
+#define IDLE_REDRAW_NS 500000000LL
+
+// height of the peak markers, in pixels
+#define PEAK_THICKNESS 2
+
+// the list layout takes its frequencies from -g, it has no button
+#define LAYOUT_BUTTONS BandList
+
+// how long a lane flashes on an onset, and how bright it starts
+#define FLASH_NS 150000000LL
+#define FLASH_ALPHA 90
+
+// how the window is redrawn
+typedef enum render_mode
+{
+    // every loop, at the analysis rate
+    ModeActive = 0,
+
+    // the input is silent and nobody touches the window, only every
+    // IDLE_REDRAW_NS
+    ModeIdle = 1
+} render_mode;
+
+const char* render_mode_names[] = { "active", "idle" };
+
+// what the visualizer shows of each device
+typedef enum view
 {
-    // groups the frequencies as filter_range blocks
-    // as the amp being the avg value of the frequencies
-    // in that block
-    Block = 1,
+    // the last frame's bands
+    ViewBars = 0,
+
+    // the bands over the last WATERFALL_ROWS frames
+    ViewWaterfall = 1
+} view;
+
+#define VIEWS 2
+
+const char* view_names[VIEWS] = { "bars", "waterfall" };
+
+// where a frame's time goes, each recorded into its own histogram
+typedef enum stage
+{
+    // waiting for and reading the hop samples
+    StageCapture = 0,
+
+    // samples to bands: window, fft, band mapping, decay
+    StageSpectrum = 1,
+
+    StageFilter = 2,
 
-    // smooths out amps as it takes the average value
-    // of the neighboring frequencies amps and makes it
-    // the result value of each frequency
-    BoxFilter = 2,
+    // BeginDrawing() up to EndDrawing()
+    StageDraw = 3,
 
-    // runs box filter twice
-    DoubleBoxFilter = 3,
+    // estimated age of the newest sample of a frame once it is shown
+    // (drawn or written out), from the samples queued behind it
+    StageLatency = 4
+} stage;
 
-    // box filter, the only difference being that
-    // more distant frequencies from each frequency
-    // contribute less to the avarage
-    WeightedFilter = 4,
+#define STAGES 5
 
-    // smooths out the fft as it uses the `alpha` value
-    // to control how much the neighboring (left/right)
-    // frequencies contribute to the smoothing
-    ExponentialFilter = 5
-} filter_type;
+const char* stage_names[STAGES] = {
+    "capture", "fft", "filter", "draw", "latency",
+};
 
 typedef struct auvi
 {
-    // sample amplitude scalar
-    int amp_scalar;
+    // the devices analyzed, the first one is the one the settings and the
+    // device buttons work on, an and cap point into it
+    pipeline pipes[MAX_PIPELINES];
+    int pipe_count;
+    analyzer* an;
+    capture* cap;
+
+    // the last frame of every pipeline, what is drawn and written out
+    pipeline_frame shown[MAX_PIPELINES];
+
+    // the shown frames one after the other, for the stream and the ring
+    float* stream;
+
     input_box ib_amp_scalar;
     slide_bar sb_amp_scalar;
     int sb_amp_scalar_max;
 
-    filter_type filter_mode;
     button b_filter_mode_block;
     button b_filter_mode_box_filter;
     button b_filter_mode_double_box_filter;
     button b_filter_mode_weighted_filter;
     button b_filter_mode_exponential_filter;
 
-    // block size, box / weighted filter range
-    int filter_range;
     input_box ib_filter_range;
-
-    // used in ExponentialFilter
-    float alpha;
     input_box ib_alpha;
 
-    // percentage of decay of amplitude in each frame
-    int decay;
-    input_box ib_decay;
+    // band ballistics, in ms
+    input_box ib_attack;
+    input_box ib_release;
+    input_box ib_peak_hold;
+
+    // applied on enter, as every keystroke would reopen the device
+    input_box ib_sample_rate;
+    input_box ib_fft_size;
+
+    input_box ib_hop;
+    button b_windows[WINDOW_TYPES];
+
+    // applied on enter, like the format
+    input_box ib_bands;
+    button b_layouts[LAYOUT_BUTTONS];
+
+    button b_stereo[STEREO_MODES];
 
-    float fft[BUFFER_SIZE];
+    button b_fft_paths[FFT_PATHS];
 
-    ALCdevice* device;
+    // where the samples come from, source is the file / stream / signal
+    // of the backends other than openal, which use the selected device
+    const capture_backend* backend;
+    char* source;
+
+    // device of the first pipeline in `devices`, -1 once it is gone from
+    // the list, and the device of every pipeline by name, which outlives
+    // rescans
     int device_idx;
+    char* pipe_devices[MAX_PIPELINES];
 
     char** devices;
     size_t devices_size;
     button* b_devices;
 
+    // rescans the devices in the gui, devices_generation is the scan
+    // `devices` came from
+    device_scan scan;
+    unsigned long devices_generation;
+
     int debug_menu;
     int settings_menu;
     int gui;
+
+    // frame stream of headless mode
+    output out;
+
+    // shared memory ring the frames are published to, header is NULL
+    // when not publishing
+    shm_writer shm;
+
+    // capture, fft and filter are recorded by the first pipeline, under
+    // its lock
+    histogram stages[STAGES];
+
+    // where the stage json goes, stdout when NULL
+    char* stats_path;
+
+    renderer renderer;
+    bars bars[MAX_PIPELINES];
+    bars peak_bars[MAX_PIPELINES];
+
+    view view;
+    waterfall falls[MAX_PIPELINES];
+
+    // the onset count each lane last flashed for, and when
+    unsigned int flashed[MAX_PIPELINES];
+    long long flash_ns[MAX_PIPELINES];
+
+    // saved after the first analyzed frame is drawn, then auvi exits
+    char* screenshot;
+
+    render_mode mode;
+    long long last_draw_ns;
+    cpu_meter cpu;
 } auvi;
 
 volatile __sig_atomic_t keep_running = 1;
+volatile __sig_atomic_t dump_stats = 0;
 
 void
 handle_sigint(int sig)
@@ -94,29 +212,15 @@ handle_sigint(int sig)
 }
 
 void
-init_devices(auvi* a)
+handle_sigusr1(int sig)
 {
-    ALCchar* devices;
-    devices = (ALCchar*)alcGetString(NULL, ALC_CAPTURE_DEVICE_SPECIFIER);
-
-    a->devices = NULL;
-    a->devices_size = 0;
-
-    int idx = 0;
-    while (*devices) {
-        char* dev_name = devices;
-
-        // move to next
-        devices += strlen(devices) + 1;
-
-        if (a->devices_size <= idx) {
-            a->devices_size++;
-            a->devices = realloc(a->devices, a->devices_size * sizeof(char*));
-        }
-        a->devices[idx] = dev_name;
+    dump_stats = 1;
+}
 
-        idx++;
-    }
+void
+init_devices(auvi* a)
+{
+    a->devices_size = devices_enumerate(&a->devices);
 }
 
 void
@@ -127,251 +231,442 @@ list_devices(auvi* a)
     }
 }
 
-void
-init_device(auvi* a)
+// opens the capture source of pipeline i at the given format
+// returns 1 on failure
+int
+init_device(auvi* a, int i, int sample_rate, int fft_size)
 {
+    char* source =
+      a->backend == &capture_openal ? a->pipe_devices[i] : a->source;
 
-    ALCdevice* device = alcCaptureOpenDevice(
-      a->devices[a->device_idx], SAMPLE_RATE, AL_FORMAT_MONO8, BUFFER_SIZE);
+    return pipeline_open(
+      &a->pipes[i], a->backend, source, sample_rate, fft_size);
+}
 
-    alcCaptureStart(device);
+// reopens the capture of pipeline i at the given format, with the
+// pipeline locked, see pipeline_switch()
+void
+switch_device(auvi* a, int i, int sample_rate, int fft_size)
+{
+    char* source =
+      a->backend == &capture_openal ? a->pipe_devices[i] : a->source;
 
-    a->device = device;
+    if (pipeline_switch(
+          &a->pipes[i], a->backend, source, sample_rate, fft_size))
+        printf("could not start the switch to %s\n", source);
 }
 
-int
-reinit_device(auvi* a)
+// selects the device of the first pipeline, with it locked
+void
+select_device(auvi* a, int idx)
 {
-    alcCaptureStop(a->device);
-    alcCaptureCloseDevice(a->device);
-    a->device = NULL;
+    char* name = strdup(a->devices[idx]);
+    if (name == NULL)
+        return;
 
-    init_device(a);
-    if (a->device == NULL) {
-        printf("could not init device capture\n");
-        return 1;
-    }
+    a->device_idx = idx;
+    for (int i = 0; i < a->devices_size; i++)
+        a->b_devices[i].pressed = i == idx;
 
-    return 0;
+    free(a->pipe_devices[0]);
+    a->pipe_devices[0] = name;
+
+    pipeline* p = &a->pipes[0];
+    switch_device(a, 0, p->target_rate, p->target_size);
 }
 
+// applies the settings of the first pipeline to the others, with it
+// locked, a format change reopens them as it did the first
 void
-apply_exponential_smoothing(float (*fft)[BUFFER_SIZE], float alpha)
+sync_pipelines(auvi* a)
 {
-    float tmp[BUFFER_SIZE];
+    analyzer* an = a->an;
+
+    for (int i = 1; i < a->pipe_count; i++) {
+        pipeline* p = &a->pipes[i];
+        analyzer* o = &p->an;
+
+        pipeline_lock(p);
+
+        o->amp_scalar = an->amp_scalar;
+        o->filter_mode = an->filter_mode;
+        o->filter_range = an->filter_range;
+        o->alpha = an->alpha;
+        o->attack_ms = an->attack_ms;
+        o->release_ms = an->release_ms;
+        o->peak_hold_ms = an->peak_hold_ms;
+        o->peak_fall_ms = an->peak_fall_ms;
+        o->detector.threshold = an->detector.threshold;
+        o->window = an->window;
+
+        if (o->stereo != an->stereo)
+            an_set_stereo(o, an->stereo);
+
+        if (p->target_rate != a->pipes[0].target_rate ||
+            p->target_size != a->pipes[0].target_size)
+            switch_device(
+              a, i, a->pipes[0].target_rate, a->pipes[0].target_size);
+
+        if (o->layout != an->layout || o->bands != an->bands ||
+            o->octave_fraction != an->octave_fraction ||
+            o->freq_count != an->freq_count) {
+            memcpy(o->freqs, an->freqs, sizeof(an->freqs));
+            o->freq_count = an->freq_count;
+            an_set_bands(o, an->layout, an->bands, an->octave_fraction);
+        }
 
-    tmp[0] = (*fft)[0];
-    for (int i = 1; i < BUFFER_SIZE; i++) {
-        tmp[i] = alpha * (*fft)[i] + (1.0f - alpha) * tmp[i - 1];
-    }
+        if (o->fft_path != an->fft_path)
+            an_set_fft_path(o, an->fft_path);
 
-    (*fft)[BUFFER_SIZE - 1] = tmp[BUFFER_SIZE - 1];
-    for (int i = BUFFER_SIZE - 2; i >= 0; i--) {
-        (*fft)[i] = alpha * tmp[i] + (1.0f - alpha) * (*fft)[i + 1];
+        o->hop = min(an->hop, o->fft_size);
+
+        pipeline_unlock(p);
     }
 }
 
 void
-apply_weighted_filter(float (*fft)[BUFFER_SIZE], int filter_range)
+sync_format_inputs(auvi* a)
 {
-    float tmp[BUFFER_SIZE];
+    char s[MAX_TEXT_SIZE];
 
-    for (int i = 0; i < BUFFER_SIZE; i++) {
-        float sum = 0;
-        float weight_sum = 0;
+    sprintf(s, "%d", a->pipes[0].target_rate);
+    ib_set_text(&a->ib_sample_rate, s);
 
-        int start = max(i - filter_range, 0);
-        int end = min(i + filter_range, BUFFER_SIZE - 1);
-        for (int j = start; j <= end; j++) {
-            // decreases the influence/contribution of more distant neighbors to
-            // the ith frequency
-            //
-            // for example the value at j = i has weight of 1 (full
-            // contribution) when j = start or j = end the weight is 0
-            float weight = 1.0f - (float)abs(i - j) / filter_range;
+    sprintf(s, "%d", a->pipes[0].target_size);
+    ib_set_text(&a->ib_fft_size, s);
+}
 
-            sum += (*fft)[j] * weight;
-            weight_sum += weight;
-        }
+// switches the first pipeline to a new sample rate / fft size, invalid
+// values are ignored
+void
+set_format(auvi* a, int sample_rate, int fft_size)
+{
+    pipeline* p = &a->pipes[0];
 
-        tmp[i] = sum / weight_sum;
+    if (!an_valid_sample_rate(sample_rate) || !an_valid_fft_size(fft_size)) {
+        printf("ignoring invalid format: %d Hz, %d samples\n",
+               sample_rate,
+               fft_size);
+        sync_format_inputs(a);
+        return;
     }
 
-    memcpy(fft, tmp, sizeof(tmp));
+    // a file or stream plays at its own rate
+    if (!a->backend->restartable)
+        sample_rate = a->cap->sample_rate;
+
+    if (sample_rate == p->target_rate && fft_size == p->target_size) {
+        sync_format_inputs(a);
+        return;
+    }
+
+    if (a->backend->restartable) {
+        switch_device(a, 0, sample_rate, fft_size);
+    } else if (an_resize(a->an, sample_rate, fft_size)) {
+        // a file or stream would lose its place, only the analyzer changes
+        printf("could not allocate buffers for %d samples\n", fft_size);
+    } else {
+        p->target_rate = sample_rate;
+        p->target_size = fft_size;
+    }
+
+    sync_format_inputs(a);
+
+    // the hop is clamped to the new size
+    char s[MAX_TEXT_SIZE];
+    sprintf(s, "%d", min(a->an->hop, p->target_size));
+    ib_set_text(&a->ib_hop, s);
 }
 
-void
-apply_box_filter(float (*fft)[BUFFER_SIZE], int filter_range)
+// waits for the next frame of the first pipeline and takes the last one
+// of every pipeline
+// returns 1 if no new frame came within CAPTURE_TIMEOUT_NS
+int
+update(auvi* a)
 {
-    float tmp[BUFFER_SIZE];
+    if (pipeline_wait(&a->pipes[0], a->shown[0].frame, CAPTURE_TIMEOUT_NS)) {
+        if (pipeline_ended(&a->pipes[0]))
+            keep_running = 0;
+        return 1;
+    }
 
-    for (int i = 0; i < BUFFER_SIZE; i++) {
-        float sum = 0;
+    for (int i = 0; i < a->pipe_count; i++)
+        pipeline_take(&a->pipes[i], &a->shown[i]);
 
-        int start = max(i - filter_range, 0);
-        int end = min(i + filter_range, BUFFER_SIZE - 1);
-        for (int j = start; j <= end; j++) {
-            sum += (*fft)[j];
-        }
+    return 0;
+}
+
+// the shown frames as one run of values, spectrum after spectrum
+float*
+stream_values(auvi* a, int* count, int* spectra)
+{
+    *count = a->shown[0].count;
+    *spectra = a->shown[0].spectra;
 
-        float avg = sum / ((end - start) + 1);
+    if (a->pipe_count == 1)
+        return a->shown[0].values;
 
-        tmp[i] = avg;
+    float* p = a->stream;
+    for (int i = 0; i < a->pipe_count; i++) {
+        memcpy(p, a->shown[i].values, a->shown[i].count * sizeof(float));
+        p += a->shown[i].count;
+
+        if (i > 0) {
+            *count += a->shown[i].count;
+            *spectra += a->shown[i].spectra;
+        }
     }
 
-    memcpy(fft, tmp, sizeof(tmp));
+    return a->stream;
 }
 
+// records the latency of the last frame, now that it is shown
 void
-apply_block_filter(float (*fft)[BUFFER_SIZE], int filter_range)
+record_latency(auvi* a)
 {
-    if (filter_range == 0)
-        return;
+    pipeline_frame* f = &a->shown[0];
+    long long behind = (long long)f->queued * NS_PER_SEC / f->sample_rate;
 
-    for (int i = 0; i < BUFFER_SIZE; i += filter_range) {
-        float sum = 0;
-        for (int j = i; j < min(i + filter_range, BUFFER_SIZE); j++) {
-            sum += (*fft)[j];
-        }
+    hist_record(&a->stages[StageLatency],
+                behind + (time_now_ns() - f->read_ns));
+}
 
-        float avg = sum / filter_range;
+// writes the stage histograms as json to a->stats_path, or stdout, with
+// the first pipeline locked
+void
+write_stats(auvi* a)
+{
+    FILE* file = stdout;
 
-        for (int j = i; j < min(i + filter_range, BUFFER_SIZE); j++) {
-            (*fft)[j] = avg;
+    if (a->stats_path != NULL) {
+        file = fopen(a->stats_path, "w");
+        if (file == NULL) {
+            printf("could not write %s\n", a->stats_path);
+            return;
         }
     }
+
+    fprintf(file,
+            "{\n  \"time_ns\": %lld,\n  \"frames\": %lld,\n"
+            "  \"sample_rate\": %d,\n  \"fft_size\": %d,\n"
+            "  \"hop\": %d,\n  \"stages\": {\n",
+            time_now_ns(),
+            a->pipes[0].frames,
+            a->an->sample_rate,
+            a->an->fft_size,
+            a->an->hop);
+
+    for (int i = 0; i < STAGES; i++) {
+        fprintf(file, "    \"%s\": ", stage_names[i]);
+        hist_write_json(&a->stages[i], file);
+        fprintf(file, i < STAGES - 1 ? ",\n" : "\n");
+    }
+
+    fprintf(file, "  }\n}\n");
+
+    if (file != stdout)
+        fclose(file);
+    else
+        fflush(file);
 }
 
+// frames per second since the first frame, against the wall clock and
+// against the time spent in the analyzer alone
 void
-filter_fft(auvi* a)
+print_stats(auvi* a)
 {
-    switch (a->filter_mode) {
-        case Block:
-            apply_block_filter(&a->fft, a->filter_range);
-            break;
-        case BoxFilter:
-            apply_box_filter(&a->fft, a->filter_range);
-            break;
-        case DoubleBoxFilter:
-            apply_box_filter(&a->fft, a->filter_range);
-            apply_box_filter(&a->fft, a->filter_range);
-            break;
-        case WeightedFilter:
-            apply_weighted_filter(&a->fft, a->filter_range);
-            break;
-        case ExponentialFilter:
-            apply_exponential_smoothing(&a->fft, a->alpha);
-            break;
+    for (int i = 0; i < a->pipe_count; i++) {
+        pipeline* p = &a->pipes[i];
+        double wall = (double)(time_now_ns() - p->stream_start) / NS_PER_SEC;
+        double dsp = (double)p->dsp_ns / NS_PER_SEC;
+
+        if (a->pipe_count > 1)
+            printf("device %d: %s\n", i, a->pipe_devices[i]);
+
+        printf("%lld frames in %.3f s, %.0f frames/s\n",
+               p->frames,
+               wall,
+               wall > 0 ? p->frames / wall : 0.0);
+        printf("dsp: %.3f s, %.2f us/frame, %.0f frames/s\n",
+               dsp,
+               p->frames > 0 ? dsp * 1e6 / p->frames : 0.0,
+               dsp > 0 ? p->frames / dsp : 0.0);
     }
 }
 
-void
-apply_fft(auvi* a, unsigned char sample_buf[BUFFER_SIZE])
+// whether the window was touched since the last poll, an open settings
+// menu counts as touched as its typing goes through the key queue, which
+// is drained here otherwise
+int
+window_input(auvi* a)
+{
+    if (a->settings_menu)
+        return 1;
+
+    Vector2 delta = GetMouseDelta();
+
+    return IsWindowResized() || delta.x != 0 || delta.y != 0 ||
+           GetMouseWheelMove() != 0 || IsMouseButtonDown(MOUSE_BUTTON_LEFT) ||
+           GetKeyPressed() != 0;
+}
+
+// 1 if every band of the shown frames is below IDLE_EPSILON
+int
+silent(auvi* a)
 {
-    // tmp storage of fft on samples
-    float fft_tmp[BUFFER_SIZE];
+    float peak = 0;
+    for (int p = 0; p < a->pipe_count; p++)
+        for (int i = 0; i < a->shown[p].count; i++)
+            peak = maxf(peak, a->shown[p].values[i]);
+
+    // falling peaks are still moving
+    for (int p = 0; p < a->pipe_count; p++)
+        for (int i = 0; a->shown[p].held && i < a->shown[p].count; i++)
+            peak = maxf(peak, a->shown[p].peaks[i]);
 
-    // since the samples are u8 values, we shift them by 256/2 to the left
-    // so we get a 0 when there is no sound at that time, instead of a 128
-    //
-    // and also scale the amps a bit for better visualization
-    int shift = (float)(256.0f / 2);
-    for (int i = 0; i < BUFFER_SIZE; i++) {
-        fft_tmp[i] = (sample_buf[i] - shift) * ((float)a->amp_scalar / shift);
+    return peak < IDLE_EPSILON;
+}
+
+// whether this loop draws, switching a->mode
+//
+// the frame that goes silent is still drawn so the flat bars are what
+// stays on screen, the first frame with signal or any input goes back to
+// active
+int
+should_draw(auvi* a, int stale)
+{
+    if (window_input(a)) {
+        a->mode = ModeActive;
+        return 1;
     }
 
-    // run the fft
-    rfft(fft_tmp, BUFFER_SIZE / 2, 1);
+    if (!stale) {
+        if (!silent(a)) {
+            a->mode = ModeActive;
+        } else if (a->mode == ModeActive) {
+            a->mode = ModeIdle;
+            return 1;
+        }
+    }
 
-    // remove dc component
-    fft_tmp[0] = fft_tmp[2];
+    return a->mode == ModeActive ||
+           time_now_ns() - a->last_draw_ns >= IDLE_REDRAW_NS;
+}
 
-    // scale down the whole result as we scale down the lower
-    // frequencies more than the higher ones to fix spectral leakage a bit
-    for (int i = 0; i < BUFFER_SIZE; i++) {
-        fft_tmp[i] *= 0.04f + (0.5f * (i / (float)BUFFER_SIZE));
+// the bands of one pipeline, in the lane from top to top + h
+void
+draw_bands(auvi* a, int lane, int top, int w, int h)
+{
+    Color color = (Color){ 200, 50, 50, 255 };
+    Color peak_color = (Color){ 240, 160, 160, 255 };
+    pipeline_frame* f = &a->shown[lane];
+
+    // split stereo puts the left bands on the left half, the right ones on
+    // the right half
+    int bands = f->count;
+
+    if (a->renderer == RendererMesh) {
+        int failed =
+          bars_draw(&a->bars[lane], f->values, bands, top, w, h, color);
+
+        if (!failed && f->held)
+            failed = bars_draw_caps(&a->peak_bars[lane],
+                                    f->peaks,
+                                    bands,
+                                    top,
+                                    w,
+                                    h,
+                                    PEAK_THICKNESS,
+                                    peak_color);
+
+        if (!failed)
+            return;
+
+        printf("could not set up the bar mesh, drawing rects\n");
+        a->renderer = RendererRects;
     }
 
-    // iterating over N/2 because rfft returns only the positive half
-    for (int i = 0; i < BUFFER_SIZE / 2; i += 2) {
-        complex c = (complex){ fft_tmp[i], fft_tmp[i + 1] };
-        float mag = cmp_abs(c);
+    for (int i = 0; i < bands; i++) {
+        int start_x, rectWidth;
+        bars_span(i, bands, w, &start_x, &rectWidth);
 
-        // remove noise from low mags
-        mag = (0.7f * log10(1.1f * mag)) + (0.7f * mag);
+        int end_y = h - (h * f->values[i]);
 
-        // clamp the mag between 0 and 1
-        mag = clampf(mag, 0.0f, 1.0f);
+        if (end_y < 0)
+            end_y = 0;
 
-        float prevmag = a->fft[i * 2];
+        if (end_y > h)
+            end_y = h;
 
-        // update if mag is greater than the prev mag
-        // we are leaving decline to the decay/fade out effect
-        if (mag > prevmag) {
-            a->fft[i * 2] = mag;
-        }
+        DrawRectangle(start_x, top + end_y, rectWidth, h - end_y, color);
 
-        // fade out declining magnitudes
-        if (mag < prevmag) {
-            a->fft[i * 2] = prevmag * (((float)a->decay) / 100.0f);
-        }
+        if (!f->held)
+            continue;
 
-        // as the result fft from rfft is N/2
-        // and half of the result again is imaginary numbers
-        // we make bins of 4 values that are equal
-        a->fft[(i * 2) + 1] = a->fft[i * 2];
-        a->fft[(i * 2) + 2] = a->fft[i * 2];
-        a->fft[(i * 2) + 3] = a->fft[i * 2];
+        int peak_y = clamp(h - (h * f->peaks[i]), 0, h);
+
+        DrawRectangle(start_x,
+                      top + peak_y,
+                      rectWidth,
+                      min(PEAK_THICKNESS, h - peak_y),
+                      peak_color);
     }
+}
 
-    // apply an averaging filter
-    filter_fft(a);
+// adds the shown frames to the waterfalls, for every new frame whether
+// it is drawn or not, so the rows keep a frame each while the idle mode
+// skips the draws
+void
+push_waterfalls(auvi* a)
+{
+    for (int i = 0; i < a->pipe_count; i++) {
+        pipeline_frame* f = &a->shown[i];
+
+        if (waterfall_push(&a->falls[i], f->values, f->count)) {
+            printf("could not create the waterfall texture, drawing bars\n");
+            a->view = ViewBars;
+            return;
+        }
+    }
 }
 
+// a fading flash over the lane after each onset of its device
 void
-update(auvi* a)
+draw_flash(auvi* a, int lane, int top, int w, int h)
 {
-    float fft_buf[BUFFER_SIZE];
-    ALCint samples;
+    long long now = time_now_ns();
+    unsigned int onsets = a->shown[lane].onsets.count;
 
-    do {
-        alcGetIntegerv(a->device, ALC_CAPTURE_SAMPLES, 1, &samples);
-        usleep(1000);
-    } while (samples < BUFFER_SIZE);
+    if (onsets != a->flashed[lane]) {
+        a->flashed[lane] = onsets;
+        a->flash_ns[lane] = now;
+    }
 
-    unsigned char sample_buf[BUFFER_SIZE];
-    alcCaptureSamples(a->device, (ALCvoid*)sample_buf, BUFFER_SIZE);
+    long long age = now - a->flash_ns[lane];
+    if (a->flash_ns[lane] == 0 || age >= FLASH_NS)
+        return;
 
-    apply_fft(a, sample_buf);
+    unsigned char alpha = FLASH_ALPHA * (FLASH_NS - age) / FLASH_NS;
+    DrawRectangle(0, top, w, h, (Color){ 255, 255, 255, alpha });
 }
 
+// every device in its own lane, the first on top
 void
 drawVisualizer(auvi* a)
 {
     int w = GetScreenWidth();
     int h = GetScreenHeight();
-    Color color = (Color){ 200, 50, 50, 255 };
 
-    float binWidth = (float)w / BUFFER_SIZE;
+    for (int i = 0; i < a->pipe_count; i++) {
+        int top = h * i / a->pipe_count;
+        int bottom = h * (i + 1) / a->pipe_count;
 
-    for (int i = 0; i < BUFFER_SIZE; i++) {
-        int start_x = (int)(i * binWidth);
-        int end_y = h - (h * a->fft[i]);
+        if (a->view == ViewWaterfall)
+            waterfall_draw(&a->falls[i], top, w, bottom - top);
+        else
+            draw_bands(a, i, top, w, bottom - top);
 
-        if (end_y < 0)
-            end_y = 0;
-
-        if (end_y > h)
-            end_y = h;
-
-        int w = (int)binWidth;
-        int next_bin_x = (int)((i + 1) * binWidth);
-        int bin_end = start_x + binWidth;
-        int rectWidth = (bin_end != next_bin_x)
-                          ? (int)(binWidth) + (next_bin_x - bin_end)
-                          : (int)(binWidth);
-
-        DrawRectangle(start_x, end_y, rectWidth, h - end_y, color);
+        draw_flash(a, i, top, w, bottom - top);
     }
 }
 
@@ -382,50 +677,136 @@ init_devices_buttons(auvi* a)
 
     for (int i = 0; i < a->devices_size; i++) {
         a->b_devices[i] = b_init(a->devices[i],
-                                 15 * 3 + (100 * 2),
+                                 15 * 4 + (100 * 3),
                                  35 * (i + 2),
                                  (int)(a->device_idx == i));
     }
 }
 
+// replaces the device list with a rescanned one, the pipelines keep their
+// devices even if those went missing
+void
+update_devices(auvi* a, char** names, size_t count)
+{
+    devices_free(a->devices, a->devices_size);
+    free(a->b_devices);
+
+    a->devices = names;
+    a->devices_size = count;
+    a->device_idx = -1;
+
+    for (int i = 0; i < count; i++)
+        if (strcmp(names[i], a->pipe_devices[0]) == 0)
+            a->device_idx = i;
+
+    init_devices_buttons(a);
+
+    printf("devices changed:\n");
+    list_devices(a);
+}
+
 void
 drawDebugMenu(auvi* a)
 {
     int w = GetScreenWidth();
     int h = GetScreenHeight();
 
-    char* s = malloc(20);
-    sprintf(s, "amp_scalar: %d", a->amp_scalar);
+    char s[64];
+    snprintf(s, sizeof(s), "amp_scalar: %d", a->an->amp_scalar);
 
-    DrawRectangle(
-      0, h - 160, MeasureText(s, 20) + 10, 160, (Color){ 30, 30, 30, 255 });
+    // wide enough for the stage table too
+    int width = max(MeasureText(s, 20),
+                    MeasureText("latency: 00000.0 / 00000.0", 20));
+
+    DrawRectangle(0, h - 480, width + 10, 480, (Color){ 30, 30, 30, 255 });
 
     DrawFPS(5, h - 20);
 
     DrawText(s, 5, h - 40, 20, LIME);
 
-    sprintf(s, "devI: %d", a->device_idx);
+    snprintf(s, sizeof(s), "devI: %d", a->device_idx);
     DrawText(s, 5, h - 60, 20, LIME);
 
-    sprintf(s, "num_devices: %zu", a->devices_size);
+    snprintf(s, sizeof(s), "num_devices: %zu", a->devices_size);
     DrawText(s, 5, h - 80, 20, LIME);
 
-    sprintf(s, "alpha: %f", a->alpha);
+    snprintf(s, sizeof(s), "alpha: %f", a->an->alpha);
     DrawText(s, 5, h - 100, 20, LIME);
 
-    sprintf(s, "decay: %d%%", a->decay);
+    snprintf(s,
+             sizeof(s),
+             "attack/release: %.0f/%.0f ms",
+             a->an->attack_ms,
+             a->an->release_ms);
     DrawText(s, 5, h - 120, 20, LIME);
 
-    sprintf(s, "filter_range: %d", a->filter_range);
+    snprintf(s, sizeof(s), "filter_range: %d", a->an->filter_range);
     DrawText(s, 5, h - 140, 20, LIME);
 
-    sprintf(s, "filter_mode: %d", (int)a->filter_mode);
+    snprintf(s, sizeof(s), "filter_mode: %d", (int)a->an->filter_mode);
     DrawText(s, 5, h - 160, 20, LIME);
 
-    free(s);
+    snprintf(s, sizeof(s), "wakeups/s: %d", a->pipes[0].wakeups.per_sec);
+    DrawText(s, 5, h - 180, 20, LIME);
+
+    if (an_active_path(a->an) == FftQ15)
+        snprintf(s, sizeof(s), "fft: q15, exponent %d", a->an->q15.exponent);
+    else if (an_active_path(a->an) == FftSliding)
+        snprintf(s, sizeof(s), "fft: sdft, %d bins", a->an->sliding.count);
+    else if (a->an->sparse)
+        snprintf(
+          s, sizeof(s), "fft: goertzel, %d bins", a->an->goertzel.count);
+    else
+        snprintf(s, sizeof(s), "fft: %s", fft_kernel_name(fft_get_kernel()));
+    DrawText(s, 5, h - 200, 20, LIME);
+
+    snprintf(s, sizeof(s), "fft_size: %d", a->an->fft_size);
+    DrawText(s, 5, h - 220, 20, LIME);
+
+    snprintf(s, sizeof(s), "sample_rate: %d", a->an->sample_rate);
+    DrawText(s, 5, h - 240, 20, LIME);
+
+    snprintf(s, sizeof(s), "hop: %d", a->an->hop);
+    DrawText(s, 5, h - 260, 20, LIME);
+
+    snprintf(s, sizeof(s), "window: %s", window_name(a->an->window));
+    DrawText(s, 5, h - 280, 20, LIME);
+
+    snprintf(s,
+             sizeof(s),
+             "bands: %d %s",
+             a->an->map.count,
+             band_layout_name(a->an->layout));
+    DrawText(s, 5, h - 300, 20, LIME);
+
+    snprintf(s, sizeof(s), "mode: %s", render_mode_names[a->mode]);
+    DrawText(s, 5, h - 320, 20, LIME);
+
+    snprintf(s, sizeof(s), "cpu: %.1f ms/s", a->cpu.ms_per_sec);
+    DrawText(s, 5, h - 340, 20, LIME);
+
+    snprintf(s,
+             sizeof(s),
+             "onsets: %u, %.0f bpm",
+             a->shown[0].onsets.count,
+             a->shown[0].onsets.bpm);
+    DrawText(s, 5, h - 360, 20, LIME);
+
+    // the stage table, p50 / p99 since the start
+    DrawText("stage: p50 / p99 us", 5, h - 480, 20, LIME);
+
+    for (int i = 0; i < STAGES; i++) {
+        snprintf(s,
+                 sizeof(s),
+                 "%s: %.1f / %.1f",
+                 stage_names[i],
+                 hist_percentile(&a->stages[i], 0.5) / 1000.0,
+                 hist_percentile(&a->stages[i], 0.99) / 1000.0);
+        DrawText(s, 5, h - 460 + 20 * i, 20, LIME);
+    }
 }
 
-int
+void
 handle_settings_menu_keys(auvi* a, button* filter_mode_buttons[5])
 {
     int key = GetKeyPressed();
@@ -433,73 +814,51 @@ handle_settings_menu_keys(auvi* a, button* filter_mode_buttons[5])
     while (key > 0) {
         switch (key) {
             case KEY_RIGHT:
-                if (a->device_idx == a->devices_size - 1) {
-                    a->device_idx = 0;
+                if (a->devices_size == 0)
+                    break;
 
-                    a->b_devices[a->devices_size - 1].pressed = false;
-                    a->b_devices[0].pressed = true;
-
-                    if (reinit_device(a))
-                        return 1;
-                } else {
-                    a->b_devices[a->device_idx].pressed = false;
-                    a->device_idx++;
-                    a->b_devices[a->device_idx].pressed = true;
-
-                    if (reinit_device(a))
-                        return 1;
-                }
+                // from a device gone missing, -1, to the first
+                select_device(a, (a->device_idx + 1) % (int)a->devices_size);
                 break;
             case KEY_LEFT:
-                if (a->device_idx == 0) {
-                    a->device_idx = a->devices_size - 1;
-
-                    a->b_devices[0].pressed = false;
-                    a->b_devices[a->devices_size - 1].pressed = true;
-
-                    if (reinit_device(a))
-                        return 1;
-                } else {
-                    a->b_devices[a->device_idx].pressed = false;
+                if (a->devices_size == 0)
+                    break;
 
-                    a->device_idx--;
-                    a->b_devices[a->device_idx].pressed = true;
-
-                    if (reinit_device(a))
-                        return 1;
-                }
+                select_device(a,
+                              a->device_idx <= 0 ? (int)a->devices_size - 1
+                                                 : a->device_idx - 1);
                 break;
             case KEY_DOWN:
-                if ((int)a->filter_mode == 5) {
+                if ((int)a->an->filter_mode == 5) {
                     a->b_filter_mode_exponential_filter.pressed = false;
-                    a->filter_mode = Block;
+                    a->an->filter_mode = Block;
                     a->b_filter_mode_block.pressed = true;
                 } else {
-                    filter_mode_buttons[a->filter_mode - 1]->pressed = false;
-                    a->filter_mode = (filter_type)(a->filter_mode + 1);
-                    filter_mode_buttons[a->filter_mode - 1]->pressed = true;
+                    filter_mode_buttons[a->an->filter_mode - 1]->pressed =
+                      false;
+                    a->an->filter_mode = (filter_type)(a->an->filter_mode + 1);
+                    filter_mode_buttons[a->an->filter_mode - 1]->pressed = true;
                 }
                 break;
             case KEY_UP:
-                if ((int)a->filter_mode == 1) {
+                if ((int)a->an->filter_mode == 1) {
                     a->b_filter_mode_block.pressed = false;
-                    a->filter_mode = ExponentialFilter;
+                    a->an->filter_mode = ExponentialFilter;
                     a->b_filter_mode_exponential_filter.pressed = true;
                 } else {
-                    filter_mode_buttons[a->filter_mode - 1]->pressed = false;
-                    a->filter_mode = (filter_type)(a->filter_mode - 1);
-                    filter_mode_buttons[a->filter_mode - 1]->pressed = true;
+                    filter_mode_buttons[a->an->filter_mode - 1]->pressed =
+                      false;
+                    a->an->filter_mode = (filter_type)(a->an->filter_mode - 1);
+                    filter_mode_buttons[a->an->filter_mode - 1]->pressed = true;
                 }
                 break;
         }
 
         key = GetKeyPressed();
     }
-
-    return 0;
 }
 
-int
+void
 handle_settings_menu(auvi* a)
 {
     button* filter_mode_buttons[5] = {
@@ -515,13 +874,18 @@ handle_settings_menu(auvi* a)
         ib_check_focus(&a->ib_amp_scalar);
         ib_check_focus(&a->ib_filter_range);
         ib_check_focus(&a->ib_alpha);
-        ib_check_focus(&a->ib_decay);
+        ib_check_focus(&a->ib_attack);
+        ib_check_focus(&a->ib_release);
+        ib_check_focus(&a->ib_peak_hold);
+        ib_check_focus(&a->ib_sample_rate);
+        ib_check_focus(&a->ib_fft_size);
+        ib_check_focus(&a->ib_hop);
+        ib_check_focus(&a->ib_bands);
     }
 
     // handle input
     {
-        if (handle_settings_menu_keys(a, filter_mode_buttons))
-            return 1;
+        handle_settings_menu_keys(a, filter_mode_buttons);
 
         // device buttons
         {
@@ -530,21 +894,15 @@ handle_settings_menu(auvi* a)
                 if (!b_get_input(&a->b_devices[i]))
                     continue;
 
-                for (int j = 0; j < a->devices_size; j++)
-                    if (j != i)
-                        a->b_devices[j].pressed = false;
-
-                a->device_idx = i;
-
-                if (reinit_device(a))
-                    return 1;
+                select_device(a, i);
+                break;
             }
         }
 
         if (ib_get_input(&a->ib_amp_scalar)) {
             int new_amp_scalar = ib_get_text_as_integer(&a->ib_amp_scalar);
 
-            a->amp_scalar = new_amp_scalar;
+            a->an->amp_scalar = new_amp_scalar;
 
             a->sb_amp_scalar.nob_x = clamp(
               (15 + 10) +
@@ -557,7 +915,7 @@ handle_settings_menu(auvi* a)
             int new_amp_scalar =
               a->sb_amp_scalar_max * sb_get_ratio(&a->sb_amp_scalar);
 
-            a->amp_scalar = new_amp_scalar;
+            a->an->amp_scalar = new_amp_scalar;
 
             char s[20];
             sprintf(s, "%d", new_amp_scalar);
@@ -565,13 +923,119 @@ handle_settings_menu(auvi* a)
         }
 
         if (ib_get_input(&a->ib_filter_range))
-            a->filter_range = ib_get_text_as_integer(&a->ib_filter_range);
+            a->an->filter_range = ib_get_text_as_integer(&a->ib_filter_range);
 
         if (ib_get_input(&a->ib_alpha))
-            a->alpha = ib_get_text_as_float(&a->ib_alpha);
+            a->an->alpha = ib_get_text_as_float(&a->ib_alpha);
+
+        if (ib_get_input(&a->ib_attack))
+            a->an->attack_ms = clampf(
+              ib_get_text_as_float(&a->ib_attack), 0, MAX_BALLISTICS_MS);
+
+        if (ib_get_input(&a->ib_release))
+            a->an->release_ms = clampf(
+              ib_get_text_as_float(&a->ib_release), 0, MAX_BALLISTICS_MS);
+
+        if (ib_get_input(&a->ib_peak_hold))
+            a->an->peak_hold_ms = clampf(
+              ib_get_text_as_float(&a->ib_peak_hold), 0, MAX_BALLISTICS_MS);
 
-        if (ib_get_input(&a->ib_decay))
-            a->decay = min(ib_get_text_as_integer(&a->ib_decay), 100);
+        if (ib_get_input(&a->ib_hop)) {
+            int hop = ib_get_text_as_integer(&a->ib_hop);
+            if (hop >= 1 && hop <= a->an->fft_size)
+                a->an->hop = hop;
+        }
+
+        // window buttons
+        {
+            for (int i = 0; i < WINDOW_TYPES; i++) {
+                if (!b_get_input(&a->b_windows[i]))
+                    continue;
+
+                for (int j = 0; j < WINDOW_TYPES; j++)
+                    if (j != i)
+                        a->b_windows[j].pressed = false;
+
+                a->an->window = (window_type)i;
+                break;
+            }
+        }
+
+        // layout buttons
+        {
+            for (int i = 0; i < LAYOUT_BUTTONS; i++) {
+                if (!b_get_input(&a->b_layouts[i]))
+                    continue;
+
+                if (an_set_bands(a->an,
+                                 (band_layout)i,
+                                 a->an->bands,
+                                 a->an->octave_fraction))
+                    printf("could not build %s bands\n",
+                           band_layout_name((band_layout)i));
+
+                for (int j = 0; j < LAYOUT_BUTTONS; j++)
+                    a->b_layouts[j].pressed = (j == (int)a->an->layout);
+
+                break;
+            }
+        }
+
+        // stereo buttons
+        {
+            for (int i = 0; i < STEREO_MODES; i++) {
+                if (!b_get_input(&a->b_stereo[i]))
+                    continue;
+
+                for (int j = 0; j < STEREO_MODES; j++)
+                    if (j != i)
+                        a->b_stereo[j].pressed = false;
+
+                an_set_stereo(a->an, (stereo_mode)i);
+                break;
+            }
+        }
+
+        // fft path buttons
+        {
+            for (int i = 0; i < FFT_PATHS; i++) {
+                if (!b_get_input(&a->b_fft_paths[i]))
+                    continue;
+
+                if (an_set_fft_path(a->an, (fft_path)i))
+                    printf("could not build the sliding dft\n");
+
+                for (int j = 0; j < FFT_PATHS; j++)
+                    a->b_fft_paths[j].pressed = (j == i);
+
+                break;
+            }
+        }
+
+        ib_get_input(&a->ib_bands);
+
+        if (a->ib_bands.focused && IsKeyPressed(KEY_ENTER)) {
+            int bands = ib_get_text_as_integer(&a->ib_bands);
+
+            if (an_set_bands(
+                  a->an, a->an->layout, bands, a->an->octave_fraction)) {
+                printf("ignoring invalid band count: %d\n", bands);
+
+                char s[MAX_TEXT_SIZE];
+                sprintf(s, "%d", a->an->bands);
+                ib_set_text(&a->ib_bands, s);
+            }
+        }
+
+        ib_get_input(&a->ib_sample_rate);
+        ib_get_input(&a->ib_fft_size);
+
+        if ((a->ib_sample_rate.focused || a->ib_fft_size.focused) &&
+            IsKeyPressed(KEY_ENTER)) {
+            set_format(a,
+                       ib_get_text_as_integer(&a->ib_sample_rate),
+                       ib_get_text_as_integer(&a->ib_fft_size));
+        }
 
         // filter mode buttons
         {
@@ -585,7 +1049,7 @@ handle_settings_menu(auvi* a)
                     if (j != i)
                         filter_mode_buttons[j]->pressed = false;
 
-                a->filter_mode = (filter_type)(i + 1);
+                a->an->filter_mode = (filter_type)(i + 1);
 
                 break;
             }
@@ -600,24 +1064,47 @@ handle_settings_menu(auvi* a)
         // background rect
         {
             int off = 10;
-            int height = off * 2 + ((35 * 4) + 5 * 2);
+            int height = off * 2 + ((35 * 6) + 5 * 2);
             DrawRectangle(
               off, off, w - (off * 2), height, (Color){ 33, 33, 33, 255 });
 
-            DrawRectangle(
-              off,
-              height + off,
-              off * 2 +
-                MeasureText(a->b_filter_mode_exponential_filter.label, 20) + 20,
-              (35 * 8) - height + 20,
-              (Color){ 33, 33, 33, 255 });
+            // under the filter and layout columns
+            DrawRectangle(off,
+                          height + off,
+                          (15 * 3 + (100 * 2)) +
+                            MeasureText(a->b_layouts[BandOctave].label, 20) +
+                            20,
+                          (35 * (12 + FFT_PATHS)) - height + 20,
+                          (Color){ 33, 33, 33, 255 });
         }
 
         ib_draw(&a->ib_amp_scalar);
         sb_draw(&a->sb_amp_scalar);
         ib_draw(&a->ib_filter_range);
         ib_draw(&a->ib_alpha);
-        ib_draw(&a->ib_decay);
+        ib_draw(&a->ib_attack);
+        ib_draw(&a->ib_release);
+        ib_draw(&a->ib_peak_hold);
+        ib_draw(&a->ib_sample_rate);
+        ib_draw(&a->ib_fft_size);
+        ib_draw(&a->ib_hop);
+        ib_draw(&a->ib_bands);
+
+        for (int i = 0; i < WINDOW_TYPES; i++) {
+            b_draw(&a->b_windows[i]);
+        }
+
+        for (int i = 0; i < LAYOUT_BUTTONS; i++) {
+            b_draw(&a->b_layouts[i]);
+        }
+
+        for (int i = 0; i < STEREO_MODES; i++) {
+            b_draw(&a->b_stereo[i]);
+        }
+
+        for (int i = 0; i < FFT_PATHS; i++) {
+            b_draw(&a->b_fft_paths[i]);
+        }
 
         b_draw(&a->b_filter_mode_block);
         b_draw(&a->b_filter_mode_box_filter);
@@ -629,105 +1116,860 @@ handle_settings_menu(auvi* a)
             b_draw(&a->b_devices[i]);
         }
     }
+}
 
-    return 0;
+// comma separated frequencies in Hz to freqs
+// returns the count, -1 if one is invalid or there are too many
+int
+parse_freqs(char* list, float* freqs)
+{
+    int count = 0;
+
+    for (char* f = strtok(list, ","); f != NULL; f = strtok(NULL, ",")) {
+        char* end;
+        float hz = strtof(f, &end);
+
+        if (end == f || *end != '\0' || hz <= 0 || count == MAX_BAND_FREQS)
+            return -1;
+
+        freqs[count++] = hz;
+    }
+
+    return count;
+}
+
+void
+print_usage(char* name)
+{
+    printf("usage: %s [options]\n"
+           "  -r, --sample-rate HZ   capture sample rate (%d..%d, default %d)\n"
+           "  -n, --fft-size N       samples per fft, power of 2 (%d..%d, "
+           "default %d)\n"
+           "  -p, --hop N            new samples per frame (1..fft size, "
+           "default %d)\n"
+           "  -a, --attack MS        time constant of a band rising, 0 for "
+           "instant (default %d)\n"
+           "  -e, --release MS       time constant of a band falling "
+           "(default %d)\n"
+           "  -k, --peak-hold MS     hold band peaks this long, 0 for no "
+           "peaks (default 0)\n"
+           "  -K, --peak-fall MS     time a peak takes to fall from the top "
+           "(default %d)\n"
+           "  -t, --onset-threshold K\n"
+           "                         deviations over the mean spectral flux "
+           "an onset needs\n"
+           "                         (default %.1f)\n"
+           "  -w, --window NAME      rect, hanning, hamming or blackman "
+           "(default hanning)\n"
+           "  -q, --fft NAME         float, q15 fixed point for u8 / s16 "
+           "samples, or\n"
+           "                         sdft, a sliding dft for small hops\n"
+           "                         (default %s)\n"
+           "  -b, --bands N          display bands (1..%d, default %d)\n"
+           "  -l, --layout NAME      linear, log, mel, octave or list band "
+           "layout (default log)\n"
+           "  -g, --freqs HZ,...     a band at each frequency, the list "
+           "layout, up to %d\n"
+           "  -o, --octave N         bands per octave of the octave layout "
+           "(default %d)\n"
+           "  -s, --shm NAME         publish frames to the shared memory "
+           "ring NAME\n"
+           "  -S, --shm-slots N      frames kept in the ring (default %d)\n"
+           "  -d, --device N|NAME    capture device, index or name "
+           "(default 0), give it\n"
+           "                         again to analyze up to %d devices at "
+           "once\n"
+           "  -L, --list-devices     list the capture devices and exit\n"
+           "  -H, --headless         no window, write frames to stdout\n"
+           "  -f, --format NAME      headless frame format: f32, u8 or "
+           "text (default f32)\n"
+           "  -c, --capture NAME     openal, wav, raw or gen (default "
+           "openal, wav with --input)\n"
+           "  -i, --input SRC        wav file, raw pcm path ('-' is stdin) "
+           "or gen signal:\n"
+           "                         sine:HZ, sweep:FROM:TO:SECONDS, white, "
+           "pink, impulse:PER_SEC\n"
+           "  -F, --sample-format NAME\n"
+           "                         openal / raw samples: u8, s16 or f32 "
+           "(default s16)\n"
+           "  -C, --channels N       openal / raw channels, 1 or 2 "
+           "(default 1)\n"
+           "  -m, --stereo NAME      stereo shown as mid, side or split "
+           "(default mid)\n"
+           "  -P, --pacing NAME      wav / gen pacing: realtime or fast "
+           "(default realtime)\n"
+           "  -T, --stats FILE       where the stage timings go as json on "
+           "SIGUSR1 and exit\n"
+           "                         (default stdout)\n"
+           "  -R, --renderer NAME    bars drawn as rects or one mesh "
+           "(default rects)\n"
+           "  -v, --view NAME        bars or waterfall, F3 switches "
+           "(default bars)\n"
+           "  -O, --screenshot FILE  save the first analyzed frame as an "
+           "image and exit\n"
+           "  -h, --help             show this help\n",
+           name,
+           MIN_SAMPLE_RATE,
+           MAX_SAMPLE_RATE,
+           DEFAULT_SAMPLE_RATE,
+           MIN_FFT_SIZE,
+           MAX_FFT_SIZE,
+           DEFAULT_FFT_SIZE,
+           DEFAULT_HOP_SIZE,
+           DEFAULT_ATTACK_MS,
+           DEFAULT_RELEASE_MS,
+           DEFAULT_PEAK_FALL_MS,
+           DEFAULT_ONSET_THRESHOLD,
+           fft_path_name(DEFAULT_FFT_PATH),
+           MAX_BANDS,
+           DEFAULT_BANDS,
+           MAX_BAND_FREQS,
+           DEFAULT_OCTAVE_FRACTION,
+           DEFAULT_SHM_SLOTS,
+           MAX_PIPELINES);
 }
 
 int
-main()
+main(int argc, char** argv)
 {
     signal(SIGINT, handle_sigint);
     signal(SIGKILL, handle_sigint);
     signal(SIGQUIT, handle_sigint);
+    signal(SIGUSR1, handle_sigusr1);
+
+    int sample_rate = DEFAULT_SAMPLE_RATE;
+    int fft_size = DEFAULT_FFT_SIZE;
+    int hop = DEFAULT_HOP_SIZE;
+    float attack_ms = DEFAULT_ATTACK_MS;
+    float release_ms = DEFAULT_RELEASE_MS;
+    float peak_hold_ms = 0;
+    float peak_fall_ms = DEFAULT_PEAK_FALL_MS;
+    float onset_threshold = DEFAULT_ONSET_THRESHOLD;
+    int window = WindowHanning;
+    int path = DEFAULT_FFT_PATH;
+    int bands = DEFAULT_BANDS;
+    int layout = BandLog;
+    int octave_fraction = DEFAULT_OCTAVE_FRACTION;
+    float freqs[MAX_BAND_FREQS];
+    int freq_count = 0;
+    char* devices[MAX_PIPELINES];
+    int device_count = 0;
+    int list = 0;
+    int headless = 0;
+    int format = OutputF32;
+    char* shm_name = NULL;
+    int shm_slots = DEFAULT_SHM_SLOTS;
+    char* input = NULL;
+    char* backend = NULL;
+    int format_samples = SampleS16;
+    int channels = 1;
+    int stereo = StereoMid;
+    int realtime = 1;
+    char* stats_path = NULL;
+    int bar_renderer = RendererRects;
+    int start_view = ViewBars;
+    char* screenshot = NULL;
+
+    static struct option long_options[] = {
+        { "sample-rate", required_argument, 0, 'r' },
+        { "fft-size", required_argument, 0, 'n' },
+        { "hop", required_argument, 0, 'p' },
+        { "attack", required_argument, 0, 'a' },
+        { "release", required_argument, 0, 'e' },
+        { "peak-hold", required_argument, 0, 'k' },
+        { "peak-fall", required_argument, 0, 'K' },
+        { "onset-threshold", required_argument, 0, 't' },
+        { "window", required_argument, 0, 'w' },
+        { "fft", required_argument, 0, 'q' },
+        { "bands", required_argument, 0, 'b' },
+        { "layout", required_argument, 0, 'l' },
+        { "octave", required_argument, 0, 'o' },
+        { "freqs", required_argument, 0, 'g' },
+        { "device", required_argument, 0, 'd' },
+        { "list-devices", no_argument, 0, 'L' },
+        { "headless", no_argument, 0, 'H' },
+        { "format", required_argument, 0, 'f' },
+        { "shm", required_argument, 0, 's' },
+        { "shm-slots", required_argument, 0, 'S' },
+        { "capture", required_argument, 0, 'c' },
+        { "input", required_argument, 0, 'i' },
+        { "sample-format", required_argument, 0, 'F' },
+        { "channels", required_argument, 0, 'C' },
+        { "stereo", required_argument, 0, 'm' },
+        { "pacing", required_argument, 0, 'P' },
+        { "stats", required_argument, 0, 'T' },
+        { "renderer", required_argument, 0, 'R' },
+        { "view", required_argument, 0, 'v' },
+        { "screenshot", required_argument, 0, 'O' },
+        { "help", no_argument, 0, 'h' },
+        { 0, 0, 0, 0 },
+    };
+
+    char* short_options =
+      "r:n:p:a:e:k:K:t:w:q:b:l:o:g:d:LHf:s:S:c:i:F:C:m:P:T:R:v:O:h";
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, short_options, long_options, NULL)) !=
+           -1) {
+        switch (opt) {
+            case 'r':
+                sample_rate = atoi(optarg);
+                break;
+            case 'n':
+                fft_size = atoi(optarg);
+                break;
+            case 'p':
+                hop = atoi(optarg);
+                break;
+            case 'a':
+                attack_ms = atof(optarg);
+                break;
+            case 'e':
+                release_ms = atof(optarg);
+                break;
+            case 'k':
+                peak_hold_ms = atof(optarg);
+                break;
+            case 'K':
+                peak_fall_ms = atof(optarg);
+                break;
+            case 't':
+                onset_threshold = atof(optarg);
+                break;
+            case 'w':
+                window = -1;
+                for (int i = 0; i < WINDOW_TYPES; i++)
+                    if (strcmp(optarg, window_name((window_type)i)) == 0)
+                        window = i;
+                break;
+            case 'q':
+                path = -1;
+                for (int i = 0; i < FFT_PATHS; i++)
+                    if (strcmp(optarg, fft_path_name((fft_path)i)) == 0)
+                        path = i;
+                break;
+            case 'b':
+                bands = atoi(optarg);
+                break;
+            case 'l':
+                layout = -1;
+                for (int i = 0; i < BAND_LAYOUTS; i++)
+                    if (strcmp(optarg, band_layout_name((band_layout)i)) == 0)
+                        layout = i;
+                break;
+            case 'o':
+                octave_fraction = atoi(optarg);
+                break;
+            case 'g':
+                freq_count = parse_freqs(optarg, freqs);
+                break;
+            case 'd':
+                if (device_count == MAX_PIPELINES) {
+                    printf("at most %d devices\n", MAX_PIPELINES);
+                    return 1;
+                }
+                devices[device_count++] = optarg;
+                break;
+            case 'L':
+                list = 1;
+                break;
+            case 'H':
+                headless = 1;
+                break;
+            case 's':
+                shm_name = optarg;
+                break;
+            case 'S':
+                shm_slots = atoi(optarg);
+                break;
+            case 'c':
+                backend = optarg;
+                break;
+            case 'i':
+                input = optarg;
+                break;
+            case 'F':
+                format_samples = -1;
+                for (int i = SampleU8; i <= SampleF32; i++)
+                    if (strcmp(optarg, sample_format_name(i)) == 0)
+                        format_samples = i;
+                break;
+            case 'C':
+                channels = atoi(optarg);
+                break;
+            case 'm':
+                stereo = -1;
+                for (int i = 0; i < STEREO_MODES; i++)
+                    if (strcmp(optarg, stereo_mode_name((stereo_mode)i)) == 0)
+                        stereo = i;
+                break;
+            case 'T':
+                stats_path = optarg;
+                break;
+            case 'R':
+                bar_renderer = -1;
+                for (int i = 0; i < RENDERERS; i++)
+                    if (strcmp(optarg, renderer_name((renderer)i)) == 0)
+                        bar_renderer = i;
+                break;
+            case 'v':
+                start_view = -1;
+                for (int i = 0; i < VIEWS; i++)
+                    if (strcmp(optarg, view_names[i]) == 0)
+                        start_view = i;
+                break;
+            case 'O':
+                screenshot = optarg;
+                break;
+            case 'P':
+                if (strcmp(optarg, "realtime") == 0)
+                    realtime = 1;
+                else if (strcmp(optarg, "fast") == 0)
+                    realtime = 0;
+                else
+                    realtime = -1;
+                break;
+            case 'f':
+                format = -1;
+                for (int i = 0; i < OUTPUT_FORMATS; i++) {
+                    const char* name = output_format_name((output_format)i);
+                    if (strcmp(optarg, name) == 0)
+                        format = i;
+                }
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (!an_valid_sample_rate(sample_rate)) {
+        printf("invalid sample rate: %d\n", sample_rate);
+        return 1;
+    }
+
+    if (!an_valid_fft_size(fft_size)) {
+        printf("invalid fft size: %d\n", fft_size);
+        return 1;
+    }
+
+    if (hop < 1 || hop > fft_size) {
+        printf("invalid hop: %d\n", hop);
+        return 1;
+    }
+
+    // negated so nan is invalid too
+    if (!(attack_ms >= 0) || !(release_ms >= 0) || !(peak_hold_ms >= 0) ||
+        !(peak_fall_ms >= 0)) {
+        printf("invalid ballistics, times are ms >= 0\n");
+        return 1;
+    }
+
+    attack_ms = minf(attack_ms, MAX_BALLISTICS_MS);
+    release_ms = minf(release_ms, MAX_BALLISTICS_MS);
+    peak_hold_ms = minf(peak_hold_ms, MAX_BALLISTICS_MS);
+    peak_fall_ms = minf(peak_fall_ms, MAX_BALLISTICS_MS);
+
+    if (onset_threshold <= 0) {
+        printf("invalid onset threshold: %g\n", onset_threshold);
+        return 1;
+    }
+
+    if (window < 0) {
+        printf("invalid window, use rect, hanning, hamming or blackman\n");
+        return 1;
+    }
+
+    if (path < 0) {
+        printf("invalid fft, use float, q15 or sdft\n");
+        return 1;
+    }
+
+    if (layout < 0) {
+        printf("invalid band layout, use linear, log, mel, octave or list\n");
+        return 1;
+    }
+
+    if (freq_count < 0) {
+        printf("invalid frequencies, use up to %d comma separated Hz\n",
+               MAX_BAND_FREQS);
+        return 1;
+    }
+
+    if (format < 0) {
+        printf("invalid format, use f32, u8 or text\n");
+        return 1;
+    }
+
+    if (realtime < 0) {
+        printf("invalid pacing, use realtime or fast\n");
+        return 1;
+    }
+
+    if (format_samples < 0) {
+        printf("invalid sample format, use u8, s16 or f32\n");
+        return 1;
+    }
+
+    if (channels < 1 || channels > MAX_CHANNELS) {
+        printf("invalid channels: %d\n", channels);
+        return 1;
+    }
+
+    if (stereo < 0) {
+        printf("invalid stereo, use mid, side or split\n");
+        return 1;
+    }
+
+    if (bar_renderer < 0) {
+        printf("invalid renderer, use rects or mesh\n");
+        return 1;
+    }
+
+    if (start_view < 0) {
+        printf("invalid view, use bars or waterfall\n");
+        return 1;
+    }
 
     auvi a;
-    a.gui = 1;
-    a.device = NULL;
+    a.gui = !headless;
+    a.out = (output){ 0 };
+    a.shm = (shm_writer){ 0 };
+    a.pipe_count = max(device_count, 1);
+    a.an = &a.pipes[0].an;
+    a.cap = &a.pipes[0].cap;
+    a.stream = NULL;
+    a.stats_path = stats_path;
+    a.renderer = (renderer)bar_renderer;
+    a.view = (view)start_view;
+    a.screenshot = screenshot;
+    a.mode = ModeActive;
+    a.last_draw_ns = 0;
+
+    for (int i = 0; i < a.pipe_count; i++) {
+        pipeline* p = &a.pipes[i];
+
+        if (pipeline_init(p)) {
+            printf("could not set up the capture threads\n");
+            return 1;
+        }
+
+        p->cap = (capture){ 0 };
+        p->cap.realtime = realtime;
+        p->cap.want_format = (sample_format)format_samples;
+        p->cap.want_channels = channels;
+
+        a.shown[i] = (pipeline_frame){ 0 };
+        a.shown[i].values = malloc(MAX_CHANNELS * MAX_BANDS * sizeof(float));
+        if (a.gui)
+            a.shown[i].peaks =
+              malloc(MAX_CHANNELS * MAX_BANDS * sizeof(float));
+
+        if (a.shown[i].values == NULL ||
+            (a.gui && a.shown[i].peaks == NULL)) {
+            printf("out of memory\n");
+            return 1;
+        }
+
+        bars_init(&a.bars[i]);
+        bars_init(&a.peak_bars[i]);
+        waterfall_init(&a.falls[i]);
+        a.flashed[i] = 0;
+        a.flash_ns[i] = 0;
+    }
+
+    int max_values = a.pipe_count * MAX_CHANNELS * MAX_BANDS;
+    if (a.pipe_count > 1) {
+        a.stream = malloc(max_values * sizeof(float));
+        if (a.stream == NULL) {
+            printf("out of memory\n");
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < STAGES; i++)
+        hist_reset(&a.stages[i]);
+
+    if (headless) {
+        // the stream owns stdout, everything printed goes to stderr
+        int fd = dup(STDOUT_FILENO);
+        FILE* stream = fd < 0 ? NULL : fdopen(fd, "wb");
+
+        if (stream == NULL || dup2(STDERR_FILENO, STDOUT_FILENO) < 0 ||
+            output_init(&a.out, stream, (output_format)format, max_values)) {
+            printf("could not set up the frame stream\n");
+            return 1;
+        }
+
+        // a reader going away ends the stream, not the process
+        signal(SIGPIPE, SIG_IGN);
+    }
+
+    a.backend = backend != NULL
+                  ? capture_find(backend)
+                  : (input != NULL ? &capture_wav : &capture_openal);
+    if (a.backend == NULL) {
+        printf("invalid capture, use openal, wav, raw or gen\n");
+        return 1;
+    }
+
+    a.source = input;
+    if (a.source == NULL && a.backend == &capture_raw)
+        a.source = "-";
+    if (a.source == NULL && a.backend == &capture_generator)
+        a.source = "sine:440";
+
+    if (a.source == NULL && a.backend == &capture_wav) {
+        printf("the wav capture needs a file, see --input\n");
+        return 1;
+    }
+
+    if (a.pipe_count > 1 && a.backend != &capture_openal) {
+        printf("several devices need the openal capture\n");
+        return 1;
+    }
+
     a.devices = NULL;
     a.devices_size = 0;
+    a.devices_generation = 0;
     a.device_idx = 0;
+    a.scan.running = 0;
+
+    for (int i = 0; i < MAX_PIPELINES; i++)
+        a.pipe_devices[i] = NULL;
+
+    if (a.backend == &capture_openal || list)
+        init_devices(&a);
+
+    if (list) {
+        list_devices(&a);
+        return 0;
+    }
+
+    if (a.backend == &capture_openal && a.devices_size == 0) {
+        printf("no devices found\n");
+        return 1;
+    }
+
+    // by index or name, the first device by default
+    for (int d = 0; a.backend == &capture_openal && d < a.pipe_count; d++) {
+        char* device = d < device_count ? devices[d] : "0";
+        char* end;
+        long idx = strtol(device, &end, 10);
+
+        if (*device == '\0' || *end != '\0' || idx < 0 ||
+            idx >= (long)a.devices_size)
+            idx = -1;
+
+        for (int i = 0; idx < 0 && i < a.devices_size; i++)
+            if (strcmp(device, a.devices[i]) == 0)
+                idx = i;
+
+        if (idx < 0) {
+            printf("unknown device: %s\n", device);
+            return 1;
+        }
+
+        if (d == 0)
+            a.device_idx = (int)idx;
+
+        a.pipe_devices[d] = strdup(a.devices[idx]);
+        if (a.pipe_devices[d] == NULL)
+            return 1;
+    }
+
+    if (init_device(&a, 0, sample_rate, fft_size)) {
+        printf("could not init device capture\n");
+        return 1;
+    }
+
+    // files and streams may bring their own rate
+    sample_rate = a.cap->sample_rate;
+    if (!an_valid_sample_rate(sample_rate)) {
+        printf("unsupported sample rate: %d\n", sample_rate);
+        return 1;
+    }
+
+    fft_select_kernel();
+
+    if (an_init(a.an, sample_rate, fft_size)) {
+        printf("could not allocate buffers for %d samples\n", fft_size);
+        return 1;
+    }
+    a.an->hop = hop;
+    a.an->attack_ms = attack_ms;
+    a.an->release_ms = release_ms;
+    a.an->peak_hold_ms = peak_hold_ms;
+    a.an->peak_fall_ms = peak_fall_ms;
+    a.an->detector.threshold = onset_threshold;
+    a.an->format = a.cap->format;
+    a.an->channels = a.cap->channels;
+    a.an->stereo = (stereo_mode)stereo;
+    a.an->window = (window_type)window;
+
+    if (an_set_fft_path(a.an, (fft_path)path))
+        printf("could not build the sliding dft, using the float fft\n");
+
+    if (freq_count > 0) {
+        layout = BandList;
+        memcpy(a.an->freqs, freqs, freq_count * sizeof(float));
+        a.an->freq_count = freq_count;
+    }
+
+    if (an_set_bands(a.an, (band_layout)layout, bands, octave_fraction)) {
+        printf("invalid bands: %d %s bands, 1/%d octave\n",
+               bands,
+               band_layout_name((band_layout)layout),
+               octave_fraction);
+        return 1;
+    }
+
+    // the other devices run at the format of the first
+    for (int i = 1; i < a.pipe_count; i++) {
+        pipeline* p = &a.pipes[i];
+
+        if (init_device(&a, i, sample_rate, fft_size)) {
+            printf("could not open %s\n", a.pipe_devices[i]);
+            return 1;
+        }
+
+        if (an_init(&p->an, sample_rate, fft_size)) {
+            printf("could not allocate buffers for %d samples\n", fft_size);
+            return 1;
+        }
+        p->an.format = p->cap.format;
+        p->an.channels = p->cap.channels;
+    }
+    sync_pipelines(&a);
+    a.cpu = cm_init();
 
-    a.amp_scalar = 5000;
-    a.ib_amp_scalar = ib_init("amp scalar", 15, 35 * 2, "5000");
+    char s[MAX_TEXT_SIZE];
+
+    sprintf(s, "%d", a.an->amp_scalar);
+    a.ib_amp_scalar = ib_init("amp scalar", 15, 35 * 2, s);
     a.sb_amp_scalar_max = 10000;
     a.sb_amp_scalar = sb_init(
       "amp scalar",
       15 + 10,
       15 + 10 + 500,
       35,
-      (15 + 10) + (((float)a.amp_scalar / (float)a.sb_amp_scalar_max) * 500));
-
-    a.filter_mode = DoubleBoxFilter;
+      (15 + 10) +
+        (((float)a.an->amp_scalar / (float)a.sb_amp_scalar_max) * 500));
 
     // filter mode buttons
     {
         a.b_filter_mode_block = b_init(
-          "block filter", 15, (35 * 4) + 5, (int)(a.filter_mode == Block));
-        a.b_filter_mode_box_filter = b_init(
-          "box filter", 15, (35 * 5) + 5, (int)(a.filter_mode == BoxFilter));
+          "block filter", 15, (35 * 6) + 5, (int)(a.an->filter_mode == Block));
+        a.b_filter_mode_box_filter =
+          b_init("box filter",
+                 15,
+                 (35 * 7) + 5,
+                 (int)(a.an->filter_mode == BoxFilter));
         a.b_filter_mode_double_box_filter =
           b_init("double box filter",
                  15,
-                 (35 * 6) + 5,
-                 (int)(a.filter_mode == DoubleBoxFilter));
+                 (35 * 8) + 5,
+                 (int)(a.an->filter_mode == DoubleBoxFilter));
         a.b_filter_mode_weighted_filter =
           b_init("weighted filter",
                  15,
-                 (35 * 7) + 5,
-                 (int)(a.filter_mode == WeightedFilter));
+                 (35 * 9) + 5,
+                 (int)(a.an->filter_mode == WeightedFilter));
         a.b_filter_mode_exponential_filter =
           b_init("exponential filter",
                  15,
-                 (35 * 8) + 5,
-                 (int)(a.filter_mode == ExponentialFilter));
+                 (35 * 10) + 5,
+                 (int)(a.an->filter_mode == ExponentialFilter));
+    }
+
+    // layout buttons, under the window buttons
+    {
+        for (int i = 0; i < LAYOUT_BUTTONS; i++) {
+            a.b_layouts[i] = b_init((char*)band_layout_name((band_layout)i),
+                                    15 * 3 + (100 * 2),
+                                    (35 * (i + 6)) + 5,
+                                    (int)(a.an->layout == i));
+        }
+    }
+
+    // stereo buttons, under the layout buttons
+    {
+        for (int i = 0; i < STEREO_MODES; i++) {
+            a.b_stereo[i] = b_init((char*)stereo_mode_name((stereo_mode)i),
+                                   15 * 3 + (100 * 2),
+                                   (35 * (i + 10)) + 5,
+                                   (int)(a.an->stereo == i));
+        }
+    }
+
+    // fft path buttons, under the attack and peak hold inputs
+    {
+        for (int i = 0; i < FFT_PATHS; i++) {
+            a.b_fft_paths[i] = b_init((char*)fft_path_name((fft_path)i),
+                                      15,
+                                      (35 * (i + 12)) + 5,
+                                      (int)(a.an->fft_path == i));
+        }
     }
 
-    a.filter_range = 8;
-    a.ib_filter_range = ib_init("fltr range", 15, 35 * 3, "8");
+    // window buttons
+    {
+        for (int i = 0; i < WINDOW_TYPES; i++) {
+            a.b_windows[i] = b_init((char*)window_name((window_type)i),
+                                    15 * 3 + (100 * 2),
+                                    (35 * (i + 2)) + 5,
+                                    (int)(a.an->window == i));
+        }
+    }
+
+    sprintf(s, "%d", a.an->filter_range);
+    a.ib_filter_range = ib_init("fltr range", 15, 35 * 3, s);
+
+    sprintf(s, "%.1f", a.an->alpha);
+    a.ib_alpha = ib_init("alpha", (15 * 2) + 100, 35 * 2, s);
+
+    sprintf(s, "%.0f", a.an->release_ms);
+    a.ib_release = ib_init("release", (15 * 2) + 100, 35 * 3, s);
+
+    // under the filter buttons
+    sprintf(s, "%.0f", a.an->attack_ms);
+    a.ib_attack = ib_init("attack", 15, (35 * 11) + 5, s);
+
+    sprintf(s, "%.0f", a.an->peak_hold_ms);
+    a.ib_peak_hold = ib_init("peak hold", (15 * 2) + 100, (35 * 11) + 5, s);
+
+    sprintf(s, "%d", a.an->sample_rate);
+    a.ib_sample_rate = ib_init("sample rate", 15, 35 * 4, s);
 
-    a.alpha = 0.2;
-    a.ib_alpha = ib_init("alpha", (15 * 2) + 100, 35 * 2, "0.2");
+    sprintf(s, "%d", a.an->fft_size);
+    a.ib_fft_size = ib_init("fft size", (15 * 2) + 100, 35 * 4, s);
 
-    a.decay = 80;
-    a.ib_decay = ib_init("decay", (15 * 2) + 100, 35 * 3, "80");
+    sprintf(s, "%d", a.an->hop);
+    a.ib_hop = ib_init("hop", 15, 35 * 5, s);
+
+    sprintf(s, "%d", a.an->bands);
+    a.ib_bands = ib_init("bands", (15 * 2) + 100, 35 * 5, s);
 
     a.settings_menu = 0;
     a.debug_menu = 0;
 
-    for (int i = 0; i < BUFFER_SIZE; i++) {
-        a.fft[i] = 0.0f;
-    }
+    init_devices_buttons(&a);
 
-    init_devices(&a);
-    if (a.devices_size == 0) {
-        printf("no devices found\n");
+    if (shm_name != NULL &&
+        shm_writer_open(&a.shm, shm_name, shm_slots, max_values)) {
+        printf("could not create the shared memory ring %s\n", shm_name);
         return 1;
     }
 
-    init_device(&a);
-    init_devices_buttons(&a);
-    if (a.device == NULL) {
-        printf("could not init device capture\n");
+    for (int i = 0; i < a.pipe_count; i++) {
+        capture* cap = &a.pipes[i].cap;
+
+        printf("using %s: %s, %d Hz, %s, %d channel%s\n",
+               a.backend->name,
+               a.backend == &capture_openal ? a.pipe_devices[i] : a.source,
+               cap->sample_rate,
+               sample_format_name(cap->format),
+               cap->channels,
+               cap->channels == 1 ? "" : "s");
+    }
+    if (an_active_path(a.an) == FftQ15)
+        printf("fft: q15\n");
+    else if (an_active_path(a.an) == FftSliding)
+        printf("fft: sdft, %d bins\n", a.an->sliding.count);
+    else if (a.an->sparse)
+        printf("fft: goertzel, %d bins\n", a.an->goertzel.count);
+    else
+        printf("fft kernel: %s\n", fft_kernel_name(fft_get_kernel()));
+
+    // every frame of a stream or file has to reach the consumer, a live
+    // device is drawn at whatever frame is the last one
+    a.pipes[0].lockstep = headless || a.backend != &capture_openal;
+    a.pipes[0].stages = a.stages;
+
+    for (int i = 0; i < a.pipe_count; i++) {
+        if (pipeline_start(&a.pipes[i])) {
+            printf("could not start the capture threads\n");
+            return 1;
+        }
+    }
+
+    if (a.gui && a.backend == &capture_openal &&
+        scan_start(&a.scan, a.devices, a.devices_size)) {
+        printf("could not start the device scan\n");
         return 1;
     }
-    printf("using device: %s\n", a.devices[a.device_idx]);
 
     if (a.gui) {
         SetConfigFlags(FLAG_WINDOW_HIGHDPI | FLAG_WINDOW_RESIZABLE);
         InitWindow(500, 400, "auvi");
         SetTargetFPS(144);
     }
-
     while (keep_running) {
         if (a.gui && WindowShouldClose()) {
             break;
         }
-        update(&a);
+        if (dump_stats) {
+            dump_stats = 0;
+
+            pipeline_lock(&a.pipes[0]);
+            write_stats(&a);
+            pipeline_unlock(&a.pipes[0]);
+        }
+
+        int stale = update(&a);
+        int count = 0;
+        int spectra = 0;
+        float* values = stale ? NULL : stream_values(&a, &count, &spectra);
+
+        // the spectra of every device, the onsets of the first one only
+        if (!stale && a.shm.header != NULL)
+            shm_writer_publish(&a.shm,
+                               values,
+                               count,
+                               spectra,
+                               a.shown[0].sample_rate,
+                               time_now_ns(),
+                               &a.shown[0].onsets);
 
         if (!a.gui) {
+            if (stale)
+                continue;
+
+            if (output_frame(&a.out,
+                             values,
+                             count,
+                             spectra,
+                             a.shown[0].sample_rate,
+                             time_now_ns(),
+                             &a.shown[0].onsets))
+                break;
+
+            record_latency(&a);
             continue;
         }
 
+        cm_roll(&a.cpu, time_now_ns());
+
+        char** names;
+        size_t names_size;
+        if (scan_take(&a.scan, &a.devices_generation, &names, &names_size))
+            update_devices(&a, names, names_size);
+
+        if (!stale && a.view == ViewWaterfall)
+            push_waterfalls(&a);
+
+        // EndDrawing() polls the events, a skipped frame has to
+        if (!should_draw(&a, stale)) {
+            PollInputEvents();
+            continue;
+        }
+
+        long long draw_start = time_now_ns();
+        a.last_draw_ns = draw_start;
+
         BeginDrawing();
         ClearBackground((Color){ 20, 20, 20, 255 });
 
@@ -741,21 +1983,73 @@ main()
             a.debug_menu = !a.debug_menu;
         }
 
+        if (IsKeyPressed(KEY_F3)) {
+            a.view = (view)((a.view + 1) % VIEWS);
+        }
+
+        if (IsKeyPressed(KEY_F5)) {
+            scan_request(&a.scan);
+        }
+
+        // the menus read and change the first pipeline
+        pipeline_lock(&a.pipes[0]);
+
         if (a.debug_menu)
             drawDebugMenu(&a);
 
-        if (a.settings_menu)
-            if (handle_settings_menu(&a))
-                return 1;
+        if (a.settings_menu) {
+            handle_settings_menu(&a);
+            sync_pipelines(&a);
+        }
+
+        pipeline_unlock(&a.pipes[0]);
+
+        hist_record(&a.stages[StageDraw], time_now_ns() - draw_start);
+
+        // read back before the swap, for comparing the renderers
+        if (!stale && a.screenshot != NULL) {
+            rlDrawRenderBatchActive();
+            TakeScreenshot(a.screenshot);
+            keep_running = 0;
+        }
 
         EndDrawing();
+
+        if (!stale)
+            record_latency(&a);
     }
 
-    alcCaptureStop(a.device);
-    alcCaptureCloseDevice(a.device);
+    scan_stop(&a.scan);
+
+    for (int i = 0; i < a.pipe_count; i++)
+        pipeline_stop(&a.pipes[i]);
+
+    if (a.pipes[0].frames > 0)
+        print_stats(&a);
+
+    write_stats(&a);
+
     if (a.gui) {
+        for (int i = 0; i < a.pipe_count; i++) {
+            bars_free(&a.bars[i]);
+            bars_free(&a.peak_bars[i]);
+            waterfall_free(&a.falls[i]);
+        }
         CloseWindow();
     }
+    for (int i = 0; i < a.pipe_count; i++) {
+        pipeline_free(&a.pipes[i]);
+        free(a.shown[i].values);
+        free(a.shown[i].peaks);
+    }
+    free(a.stream);
     free(a.b_devices);
+    devices_free(a.devices, a.devices_size);
+
+    for (int i = 0; i < a.pipe_count; i++)
+        free(a.pipe_devices[i]);
+
+    output_free(&a.out);
+    shm_writer_close(&a.shm);
     return 0;
 }
@@ -0,0 +1,135 @@
+#include "onset.h"
+#include <math.h>
+#include <stdlib.h>
+
+int
+onset_init(onset_detector* d)
+{
+    d->threshold = DEFAULT_ONSET_THRESHOLD;
+    d->history = malloc(ONSET_MAX_WINDOW * sizeof(float));
+    d->window = 0;
+    d->time = 0;
+
+    onset_reset(d);
+    return d->history == NULL;
+}
+
+void
+onset_reset(onset_detector* d)
+{
+    d->filled = 0;
+    d->pos = 0;
+    d->sum = 0;
+    d->sum_sq = 0;
+    d->last_onset = -1;
+    d->tempo_count = 0;
+    d->tempo_pos = 0;
+    d->bpm = 0;
+}
+
+// the median of the folded tempos
+static float
+median_tempo(const onset_detector* d)
+{
+    float t[ONSET_INTERVALS];
+    int n = d->tempo_count;
+
+    for (int i = 0; i < n; i++) {
+        float v = d->tempos[i];
+        int j = i;
+
+        for (; j > 0 && t[j - 1] > v; j--)
+            t[j] = t[j - 1];
+
+        t[j] = v;
+    }
+
+    return n % 2 ? t[n / 2] : (t[n / 2 - 1] + t[n / 2]) / 2;
+}
+
+static void
+add_interval(onset_detector* d, float interval)
+{
+    if (interval > ONSET_MAX_INTERVAL_S) {
+        d->tempo_count = 0;
+        d->tempo_pos = 0;
+        d->bpm = 0;
+        return;
+    }
+
+    float bpm = 60 / interval;
+
+    while (bpm < ONSET_MIN_BPM)
+        bpm *= 2;
+
+    while (bpm > ONSET_MAX_BPM)
+        bpm /= 2;
+
+    d->tempos[d->tempo_pos] = bpm;
+    d->tempo_pos = (d->tempo_pos + 1) % ONSET_INTERVALS;
+    if (d->tempo_count < ONSET_INTERVALS)
+        d->tempo_count++;
+
+    // a couple of intervals agree on little
+    if (d->tempo_count >= ONSET_INTERVALS / 2)
+        d->bpm = median_tempo(d);
+}
+
+int
+onset_update(onset_detector* d, float flux, float dt)
+{
+    // the window in frames follows the hop and rate
+    int window = (int)(ONSET_WINDOW_S / dt + 0.5f);
+    window = window < ONSET_MIN_WINDOW ? ONSET_MIN_WINDOW : window;
+    window = window > ONSET_MAX_WINDOW ? ONSET_MAX_WINDOW : window;
+
+    if (window != d->window) {
+        d->window = window;
+        onset_reset(d);
+    }
+
+    d->time += dt;
+
+    int onset = 0;
+
+    // tested against the frames before it
+    if (d->filled >= ONSET_MIN_WINDOW) {
+        double mean = d->sum / d->filled;
+        double var = d->sum_sq / d->filled - mean * mean;
+        double limit = mean + d->threshold * sqrt(var > 0 ? var : 0);
+
+        onset = flux > limit + ONSET_FLOOR &&
+                (d->last_onset < 0 ||
+                 d->time - d->last_onset >= ONSET_MIN_GAP_S);
+    }
+
+    if (onset) {
+        if (d->last_onset >= 0)
+            add_interval(d, (float)(d->time - d->last_onset));
+
+        d->last_onset = d->time;
+    }
+
+    // the ring, dropping the oldest once full
+    if (d->filled == d->window) {
+        float old = d->history[d->pos];
+        d->sum -= old;
+        d->sum_sq -= (double)old * old;
+    } else {
+        d->filled++;
+    }
+
+    d->history[d->pos] = flux;
+    d->sum += flux;
+    d->sum_sq += (double)flux * flux;
+    d->pos = (d->pos + 1) % d->window;
+
+    return onset;
+}
+
+void
+onset_free(onset_detector* d)
+{
+    free(d->history);
+    d->history = NULL;
+}
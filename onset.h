@@ -0,0 +1,87 @@
+#ifndef ONSET
+#define ONSET
+
+// seconds of flux history the threshold adapts over
+#define ONSET_WINDOW_S 1.0f
+
+// frames the history holds at most, and needs before the first onset
+#define ONSET_MAX_WINDOW 4096
+#define ONSET_MIN_WINDOW 8
+
+// an onset this soon after the last one is the same one
+#define ONSET_MIN_GAP_S 0.1f
+
+// flux an onset needs over the threshold, so silence and steady noise,
+// whose deviation is near 0, do not trigger
+#define ONSET_FLOOR 0.005f
+
+// default deviations over the mean flux an onset needs
+#define DEFAULT_ONSET_THRESHOLD 3.0f
+
+// onset intervals the tempo is the median of, and the range it is
+// folded into by doubling or halving
+#define ONSET_INTERVALS 8
+#define ONSET_MIN_BPM 70.0f
+#define ONSET_MAX_BPM 180.0f
+
+// longer pauses between onsets restart the tempo
+#define ONSET_MAX_INTERVAL_S 2.0f
+
+// finds onsets in the spectral flux of the frames, the summed rise of the
+// bands over the last frame
+//
+// the threshold is the mean plus `threshold` deviations of the flux over
+// the last ONSET_WINDOW_S, kept as running sums over a ring so a frame
+// costs the same whatever the window
+typedef struct onset_detector
+{
+    float threshold;
+
+    // flux of the last `window` frames, `filled` of them set, the next
+    // goes to pos
+    float* history;
+    int window;
+    int filled;
+    int pos;
+    double sum;
+    double sum_sq;
+
+    // seconds analyzed and the time of the last onset, < 0 for none
+    double time;
+    double last_onset;
+
+    // the last intervals between onsets, as folded tempos
+    float tempos[ONSET_INTERVALS];
+    int tempo_count;
+    int tempo_pos;
+
+    // the tempo in beats per minute, 0 until there are enough onsets
+    float bpm;
+} onset_detector;
+
+// what a frame says about the onsets: how many there were so far, the
+// monotonic time of the last one, 0 before the first, and the tempo
+typedef struct onset_info
+{
+    unsigned int count;
+    long long last_ns;
+    float bpm;
+} onset_info;
+
+// returns 1 on failure
+int
+onset_init(onset_detector* d);
+
+// forgets the history, after a change the flux jumps with
+void
+onset_reset(onset_detector* d);
+
+// adds the flux of a frame of dt seconds
+// returns 1 if the frame is an onset
+int
+onset_update(onset_detector* d, float flux, float dt);
+
+void
+onset_free(onset_detector* d);
+
+#endif
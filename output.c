@@ -0,0 +1,171 @@
+#include "output.h"
+#include <stdlib.h>
+#include <string.h>
+
+// the longest text line header, 7 numbers of up to 20 digits and their
+// separators, and the longest " %.4f" of a value
+#define OUTPUT_TEXT_HEADER_SIZE 192
+#define OUTPUT_TEXT_VALUE_SIZE 8
+
+const char*
+output_format_name(output_format format)
+{
+    switch (format) {
+        case OutputU8:
+            return "u8";
+        case OutputText:
+            return "text";
+        default:
+            return "f32";
+    }
+}
+
+// bytes of the longest frame of max_values values, the text values being
+// in -9..9, which the 0..1 bands stay well within
+static size_t
+frame_size(output_format format, int max_values)
+{
+    switch (format) {
+        case OutputU8:
+            return OUTPUT_HEADER_SIZE + (size_t)max_values;
+        case OutputText:
+            return OUTPUT_TEXT_HEADER_SIZE +
+                   (size_t)max_values * OUTPUT_TEXT_VALUE_SIZE;
+        default:
+            return OUTPUT_HEADER_SIZE + (size_t)max_values * sizeof(float);
+    }
+}
+
+int
+output_init(output* out, FILE* file, output_format format, int max_values)
+{
+    size_t size = frame_size(format, max_values);
+
+    out->file = file;
+    out->format = format;
+    out->frame = 0;
+    out->max_values = max_values;
+    out->buf = malloc(OUTPUT_HEADER_SIZE + max_values * sizeof(float));
+    out->file_buf = malloc(size);
+
+    if (!out->buf || !out->file_buf)
+        return 1;
+
+    // a frame fits the buffer, so it goes out as one write on the flush,
+    // never split over two (glibc ignores the size without a buffer)
+    return setvbuf(file, out->file_buf, _IOFBF, size) != 0;
+}
+
+// little endian stores, whatever the host order
+static void
+put_u16(unsigned char* p, unsigned int v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+}
+
+static void
+put_u32(unsigned char* p, unsigned int v)
+{
+    put_u16(p, v & 0xffff);
+    put_u16(p + 2, v >> 16);
+}
+
+static void
+put_u64(unsigned char* p, unsigned long long v)
+{
+    put_u32(p, (unsigned int)(v & 0xffffffffu));
+    put_u32(p + 4, (unsigned int)(v >> 32));
+}
+
+static void
+write_text(output* out,
+           const float* values,
+           int count,
+           int spectra,
+           long long timestamp_ns,
+           const onset_info* onsets)
+{
+    fprintf(out->file,
+            "%llu %lld %d %d %u %.1f %lld",
+            out->frame,
+            timestamp_ns,
+            count,
+            spectra,
+            onsets->count,
+            onsets->bpm,
+            onsets->last_ns);
+
+    for (int i = 0; i < count; i++)
+        fprintf(out->file, " %.4f", values[i]);
+
+    fputc('\n', out->file);
+}
+
+int
+output_frame(output* out,
+             const float* values,
+             int count,
+             int spectra,
+             int sample_rate,
+             long long timestamp_ns,
+             const onset_info* onsets)
+{
+    if (count > out->max_values)
+        count = out->max_values;
+
+    if (out->format == OutputText) {
+        write_text(out, values, count, spectra, timestamp_ns, onsets);
+    } else {
+        unsigned char* p = out->buf;
+
+        put_u32(p, OUTPUT_MAGIC);
+        put_u16(p + 4, OUTPUT_VERSION);
+        p[6] = (unsigned char)out->format;
+        p[7] = (unsigned char)spectra;
+        put_u32(p + 8, (unsigned int)count);
+        put_u32(p + 12, (unsigned int)sample_rate);
+        put_u64(p + 16, out->frame);
+        put_u64(p + 24, (unsigned long long)timestamp_ns);
+
+        unsigned int bpm;
+        memcpy(&bpm, &onsets->bpm, sizeof(bpm));
+        put_u32(p + 32, onsets->count);
+        put_u32(p + 36, bpm);
+        put_u64(p + 40, (unsigned long long)onsets->last_ns);
+        p += OUTPUT_HEADER_SIZE;
+
+        if (out->format == OutputU8) {
+            for (int i = 0; i < count; i++)
+                p[i] = (unsigned char)(values[i] * 255.0f + 0.5f);
+            p += count;
+        } else {
+            for (int i = 0; i < count; i++) {
+                unsigned int bits;
+                memcpy(&bits, &values[i], sizeof(bits));
+                put_u32(p + 4 * i, bits);
+            }
+            p += 4 * count;
+        }
+
+        fwrite(out->buf, 1, p - out->buf, out->file);
+    }
+
+    out->frame++;
+
+    return fflush(out->file) != 0 || ferror(out->file);
+}
+
+void
+output_free(output* out)
+{
+    // closed before its buffer goes
+    if (out->file)
+        fclose(out->file);
+
+    free(out->buf);
+    free(out->file_buf);
+    out->file = NULL;
+    out->buf = NULL;
+    out->file_buf = NULL;
+}
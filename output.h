@@ -0,0 +1,85 @@
+#ifndef OUTPUT
+#define OUTPUT
+
+#include "onset.h"
+#include <stdio.h>
+
+// frame stream written by headless mode
+//
+// each binary frame is a header followed by `count` values, all little
+// endian:
+//
+//   0  u32  magic, "AUVI"
+//   4  u16  version
+//   6  u8   format, OutputF32 or OutputU8
+//   7  u8   spectra, 1, or 2 for split stereo
+//   8  u32  count of values, count / spectra bands per spectrum
+//   12 u32  sample rate
+//   16 u64  frame index, from 0
+//   24 i64  monotonic timestamp in ns
+//   32 u32  onsets found so far, a reader sees one wherever it grew
+//   36 f32  tempo in beats per minute, 0 while unknown
+//   40 i64  monotonic timestamp of the last onset in ns, 0 before the
+//           first
+//   48      count f32 (0..1) or u8 (0..255) values, spectrum after
+//           spectrum
+//
+// with several devices the spectra of all of them follow each other, but
+// the onsets, tempo and sample rate are those of the first device only
+//
+// the text format writes one line per frame instead:
+//   frame timestamp_ns count spectra onsets bpm onset_ns v0 v1 ...
+
+#define OUTPUT_MAGIC 0x49565541u
+#define OUTPUT_VERSION 3
+#define OUTPUT_HEADER_SIZE 48
+
+typedef enum output_format
+{
+    OutputF32 = 0,
+    OutputU8 = 1,
+    OutputText = 2
+} output_format;
+
+#define OUTPUT_FORMATS 3
+
+typedef struct output
+{
+    FILE* file;
+    output_format format;
+
+    // one encoded frame, allocated for max_values up front
+    unsigned char* buf;
+    int max_values;
+
+    // the stdio buffer of file, room for the longest frame so a frame
+    // goes out as one write on the flush
+    char* file_buf;
+
+    unsigned long long frame;
+} output;
+
+const char*
+output_format_name(output_format format);
+
+// the output owns file from here on, output_free() closes it
+// returns 1 on failure
+int
+output_init(output* out, FILE* file, output_format format, int max_values);
+
+// writes and flushes one frame of count values (clamped to max_values) of
+// `spectra` spectra
+// returns 1 on a write error, e.g. the reader went away
+int
+output_frame(output* out,
+             const float* values,
+             int count,
+             int spectra,
+             int sample_rate,
+             long long timestamp_ns,
+             const onset_info* onsets);
+
+void
+output_free(output* out);
+
+#endif
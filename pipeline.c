@@ -0,0 +1,486 @@
+#include "pipeline.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// an absolute CLOCK_MONOTONIC deadline, what the conds wait against
+static struct timespec
+deadline(long long ns)
+{
+    struct timespec ts;
+    ts.tv_sec = ns / NS_PER_SEC;
+    ts.tv_nsec = ns % NS_PER_SEC;
+    return ts;
+}
+
+int
+pipeline_init(pipeline* p)
+{
+    pthread_condattr_t attr;
+
+    p->running = 0;
+    p->stop = 0;
+    p->lockstep = 0;
+    p->stages = NULL;
+    p->wakeups = rc_init();
+    p->frames = 0;
+    p->taken = 0;
+    p->stream_start = 0;
+    p->dsp_ns = 0;
+    p->read_ns = 0;
+    p->queued = 0;
+    p->onsets = (onset_info){ 0 };
+    p->source = NULL;
+    p->target_rate = 0;
+    p->target_size = 0;
+    p->switch_backend = NULL;
+    p->switch_source = NULL;
+    p->switching = 0;
+    p->switcher_joinable = 0;
+
+    if (pthread_condattr_init(&attr))
+        return 1;
+
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+    int failed = pthread_mutex_init(&p->lock, NULL) ||
+                 pthread_cond_init(&p->wake, &attr) ||
+                 pthread_cond_init(&p->produced, &attr);
+
+    pthread_condattr_destroy(&attr);
+    return failed;
+}
+
+// reads and analyzes one hop, with the lock held
+static void
+analyze(pipeline* p, long long wait_start)
+{
+    int hop = p->an.hop;
+    long long start = time_now_ns();
+
+    // a partial hop at the end of a file or stream is dropped
+    if (capture_read(&p->cap, p->an.samples, hop) < hop)
+        return;
+
+    p->queued = capture_available(&p->cap);
+
+    if (p->frames == 0)
+        p->stream_start = start;
+
+    p->read_ns = start;
+
+    an_process(&p->an);
+
+    if (p->an.onset) {
+        p->onsets.count++;
+        p->onsets.last_ns = start;
+    }
+    p->onsets.bpm = p->an.detector.bpm;
+
+    long long end = time_now_ns();
+    p->dsp_ns += end - start;
+    p->frames++;
+
+    rc_roll(&p->wakeups, end);
+
+    if (p->stages != NULL) {
+        hist_record(&p->stages[0], start - wait_start);
+        hist_record(&p->stages[1], p->an.spectrum_ns);
+        hist_record(&p->stages[2], p->an.filter_ns);
+    }
+
+    pthread_cond_broadcast(&p->produced);
+}
+
+// analyzes a frame whenever the capture has a hop queued
+//
+// sleeps until the missing samples should have been captured, then polls
+// every CAPTURE_POLL_NS for late devices, a closed capture (a reopen that
+// failed) is polled the same way
+static void*
+run(void* arg)
+{
+    pipeline* p = arg;
+    long long wait_start = time_now_ns();
+
+    pthread_mutex_lock(&p->lock);
+
+    while (!p->stop) {
+        int ended = p->cap.backend != NULL && p->cap.eof;
+        int samples =
+          p->cap.backend != NULL ? capture_available(&p->cap) : 0;
+
+        // the consumer has to catch up first, and once a file or stream
+        // ended there is nothing left to do until stopped
+        if ((p->lockstep && p->taken < p->frames) ||
+            (ended && samples < p->an.hop)) {
+            pthread_cond_wait(&p->wake, &p->lock);
+            wait_start = time_now_ns();
+            continue;
+        }
+
+        if (samples >= p->an.hop) {
+            analyze(p, wait_start);
+            wait_start = time_now_ns();
+            continue;
+        }
+
+        long long wait = (long long)(p->an.hop - samples) * NS_PER_SEC /
+                         p->an.sample_rate;
+        if (wait < CAPTURE_POLL_NS)
+            wait = CAPTURE_POLL_NS;
+
+        long long now = time_now_ns();
+        struct timespec ts = deadline(now + wait);
+        pthread_cond_timedwait(&p->wake, &p->lock, &ts);
+
+        rc_tick(&p->wakeups, time_now_ns());
+    }
+
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+// opens the source and waits up to SWITCH_TIMEOUT_NS for its first
+// samples
+// returns 1 on failure, leaving cap closed
+static int
+open_delivering(capture* cap,
+                const capture_backend* backend,
+                const char* source,
+                int sample_rate,
+                int fft_size)
+{
+    if (capture_open(cap, backend, source, sample_rate, fft_size))
+        return 1;
+
+    long long give_up = time_now_ns() + SWITCH_TIMEOUT_NS;
+
+    while (capture_available(cap) == 0) {
+        long long now = time_now_ns();
+
+        if (now > give_up) {
+            capture_close(cap);
+            return 1;
+        }
+
+        time_sleep_until_ns(now + CAPTURE_POLL_NS);
+    }
+
+    return 0;
+}
+
+// swaps the opened capture in and the current one out into `next`, with
+// the lock held
+// returns 1 if the analyzer could not take the new format
+static int
+swap_in(pipeline* p, capture* next, int sample_rate, int fft_size)
+{
+    analyzer* an = &p->an;
+
+    if ((an->sample_rate != sample_rate || an->fft_size != fft_size) &&
+        an_resize(an, sample_rate, fft_size))
+        return 1;
+
+    capture old = p->cap;
+    p->cap = *next;
+    *next = old;
+
+    // another device may not have float capture or stereo
+    an->format = p->cap.format;
+    if (an->channels != p->cap.channels) {
+        an->channels = p->cap.channels;
+        an_set_stereo(an, an->stereo);
+    }
+
+    return 0;
+}
+
+// 1 if the request is for the source the capture runs, with the lock held
+static int
+same_source(pipeline* p, const capture_backend* backend, const char* source)
+{
+    return p->source != NULL && p->cap.backend == backend &&
+           strcmp(p->source, source) == 0;
+}
+
+// closes the current capture and opens its source at the new format into
+// `next`, with the lock held, released meanwhile
+// returns 1 on failure, the old format is then reopened and swapped in, or
+// the capture stays closed if that fails too
+static int
+reopen(pipeline* p,
+       capture* next,
+       const capture_backend* backend,
+       const char* source,
+       int sample_rate,
+       int fft_size)
+{
+    int old_rate = p->an.sample_rate;
+    int old_size = p->an.fft_size;
+
+    // the thread polls a closed capture until one is swapped in
+    *next = p->cap;
+    p->cap.backend = NULL;
+    pthread_mutex_unlock(&p->lock);
+
+    capture_close(next);
+
+    int failed = open_delivering(next, backend, source, sample_rate, fft_size);
+    int restored =
+      failed && !open_delivering(next, backend, source, old_rate, old_size);
+
+    pthread_mutex_lock(&p->lock);
+
+    if (!failed)
+        return 0;
+
+    // the analyzer is still at the old format, there is nothing to resize
+    if (!restored || swap_in(p, next, old_rate, old_size))
+        printf("could not reopen %s\n", source);
+
+    return 1;
+}
+
+// works through the switch requests, the slow opens and closes with the
+// lock released
+static void*
+switcher(void* arg)
+{
+    pipeline* p = arg;
+
+    pthread_mutex_lock(&p->lock);
+
+    while (p->switch_source != NULL && !p->stop) {
+        const capture_backend* backend = p->switch_backend;
+        char* source = p->switch_source;
+        int rate = p->switch_rate;
+        int size = p->switch_size;
+
+        // takes the wanted format and pacing of the current one
+        capture next = p->cap;
+
+        p->switch_source = NULL;
+        pthread_mutex_unlock(&p->lock);
+
+        int failed =
+          open_delivering(&next, backend, source, rate, size);
+
+        pthread_mutex_lock(&p->lock);
+
+        // a newer request or a stop makes this one moot
+        int moot = p->switch_source != NULL || p->stop;
+
+        if (failed && !moot && same_source(p, backend, source))
+            failed = reopen(p, &next, backend, source, rate, size);
+
+        if (failed) {
+            printf("could not switch to %s\n", source);
+        } else if (!moot && swap_in(p, &next, rate, size)) {
+            printf("could not allocate buffers for %d samples\n", size);
+            failed = 1;
+        } else if (!moot) {
+            free(p->source);
+            p->source = source;
+            source = NULL;
+        }
+
+        if (failed && !moot) {
+            p->target_rate = p->an.sample_rate;
+            p->target_size = p->an.fft_size;
+        }
+
+        pthread_cond_broadcast(&p->wake);
+        pthread_mutex_unlock(&p->lock);
+
+        // the old capture after a swap, the unused new one otherwise
+        capture_close(&next);
+        free(source);
+
+        pthread_mutex_lock(&p->lock);
+    }
+
+    p->switching = 0;
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+int
+pipeline_switch(pipeline* p,
+                const capture_backend* backend,
+                const char* source,
+                int sample_rate,
+                int fft_size)
+{
+    char* copy = strdup(source);
+    if (copy == NULL)
+        return 1;
+
+    free(p->switch_source);
+    p->switch_backend = backend;
+    p->switch_source = copy;
+    p->switch_rate = sample_rate;
+    p->switch_size = fft_size;
+    p->target_rate = sample_rate;
+    p->target_size = fft_size;
+
+    if (p->switching)
+        return 0;
+
+    // done, it released the lock for the last time before we took it
+    if (p->switcher_joinable)
+        pthread_join(p->switcher, NULL);
+
+    p->switcher_joinable = 0;
+
+    if (pthread_create(&p->switcher, NULL, switcher, p)) {
+        free(p->switch_source);
+        p->switch_source = NULL;
+        p->target_rate = p->an.sample_rate;
+        p->target_size = p->an.fft_size;
+        return 1;
+    }
+
+    p->switching = 1;
+    p->switcher_joinable = 1;
+    return 0;
+}
+
+int
+pipeline_open(pipeline* p,
+              const capture_backend* backend,
+              const char* source,
+              int sample_rate,
+              int fft_size)
+{
+    free(p->source);
+    p->source = strdup(source);
+    if (p->source == NULL)
+        return 1;
+
+    return capture_open(&p->cap, backend, source, sample_rate, fft_size);
+}
+
+int
+pipeline_start(pipeline* p)
+{
+    p->stop = 0;
+    p->target_rate = p->an.sample_rate;
+    p->target_size = p->an.fft_size;
+
+    if (pthread_create(&p->thread, NULL, run, p))
+        return 1;
+
+    p->running = 1;
+    return 0;
+}
+
+void
+pipeline_stop(pipeline* p)
+{
+    if (!p->running)
+        return;
+
+    pthread_mutex_lock(&p->lock);
+    p->stop = 1;
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+
+    pthread_join(p->thread, NULL);
+    p->running = 0;
+
+    if (p->switcher_joinable)
+        pthread_join(p->switcher, NULL);
+
+    p->switcher_joinable = 0;
+    free(p->switch_source);
+    p->switch_source = NULL;
+}
+
+void
+pipeline_free(pipeline* p)
+{
+    pipeline_stop(p);
+
+    capture_close(&p->cap);
+    an_free(&p->an);
+    free(p->source);
+    p->source = NULL;
+
+    pthread_cond_destroy(&p->produced);
+    pthread_cond_destroy(&p->wake);
+    pthread_mutex_destroy(&p->lock);
+}
+
+void
+pipeline_lock(pipeline* p)
+{
+    pthread_mutex_lock(&p->lock);
+}
+
+void
+pipeline_unlock(pipeline* p)
+{
+    // settings may have changed the hop or reopened the capture
+    pthread_cond_broadcast(&p->wake);
+    pthread_mutex_unlock(&p->lock);
+}
+
+int
+pipeline_wait(pipeline* p, long long seen, long long timeout_ns)
+{
+    struct timespec ts = deadline(time_now_ns() + timeout_ns);
+
+    pthread_mutex_lock(&p->lock);
+
+    int waited = 0;
+    while (p->frames <= seen && !waited)
+        waited = pthread_cond_timedwait(&p->produced, &p->lock, &ts) != 0;
+
+    int fresh = p->frames > seen;
+    pthread_mutex_unlock(&p->lock);
+
+    return !fresh;
+}
+
+int
+pipeline_ended(pipeline* p)
+{
+    pthread_mutex_lock(&p->lock);
+
+    int ended = p->cap.backend != NULL && p->cap.eof &&
+                capture_available(&p->cap) < p->an.hop &&
+                p->taken == p->frames;
+
+    pthread_mutex_unlock(&p->lock);
+    return ended;
+}
+
+void
+pipeline_take(pipeline* p, pipeline_frame* out)
+{
+    pthread_mutex_lock(&p->lock);
+
+    int spectra = an_spectra(&p->an);
+
+    out->count = p->an.map.count * spectra;
+    out->spectra = spectra;
+    out->frame = p->frames;
+    out->sample_rate = p->an.sample_rate;
+    out->read_ns = p->read_ns;
+    out->queued = p->queued;
+    out->onsets = p->onsets;
+    memcpy(out->values, p->an.fft, out->count * sizeof(float));
+
+    out->held = p->an.peak_hold_ms > 0;
+    if (out->peaks != NULL && out->held)
+        memcpy(out->peaks, p->an.peaks, out->count * sizeof(float));
+
+    if (p->taken < p->frames) {
+        p->taken = p->frames;
+        pthread_cond_broadcast(&p->wake);
+    }
+
+    pthread_mutex_unlock(&p->lock);
+}
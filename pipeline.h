@@ -0,0 +1,176 @@
+#ifndef PIPELINE
+#define PIPELINE
+
+#include "analyzer.h"
+#include "capture.h"
+#include "histogram.h"
+#include "timing.h"
+#include <pthread.h>
+
+// devices analyzed at once
+#define MAX_PIPELINES 8
+
+// poll interval used once the computed deadline has passed but the device
+// has not delivered yet (drivers often hand out samples in periods)
+#define CAPTURE_POLL_NS 1000000LL
+
+// what a pipeline records into its stages histograms, in this order
+#define PIPELINE_STAGES 3
+
+// how long a reopened device has to deliver its first samples
+#define SWITCH_TIMEOUT_NS 2000000000LL
+
+// a capture source and its analyzer, run on their own thread
+//
+// the thread holds `lock` whenever it touches cap or an, so whoever holds
+// it can change the settings or read the analyzer; the bands to show are
+// copied out with pipeline_take() and the capture is reopened with
+// pipeline_switch()
+typedef struct pipeline
+{
+    capture cap;
+    analyzer an;
+
+    // the source cap was opened with, to reopen it in place
+    char* source;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+
+    // the thread sleeps on wake, the consumer on produced
+    pthread_cond_t wake;
+    pthread_cond_t produced;
+
+    int running;
+    int stop;
+
+    // 1 to analyze a frame only once the last one was taken, so the
+    // consumer sees all of them (headless streams, files read fast)
+    int lockstep;
+
+    // capture wait, spectrum and filter times of every frame, NULL for
+    // none
+    histogram* stages;
+
+    // sleeps done while waiting for capture samples
+    rate_counter wakeups;
+
+    // frames analyzed and taken, time of the first and the time spent in
+    // the analyzer
+    long long frames;
+    long long taken;
+    long long stream_start;
+    long long dsp_ns;
+
+    // when the last frame's samples were read and how many were queued
+    // behind them
+    long long read_ns;
+    int queued;
+
+    // onsets found so far, the last at the time its frame was read
+    onset_info onsets;
+
+    // the format the capture runs at, or is being reopened at
+    int target_rate;
+    int target_size;
+
+    // the reopen asked for last, switch_source is NULL once the switcher
+    // took it, and the switcher thread, joined by the next switch
+    const capture_backend* switch_backend;
+    char* switch_source;
+    int switch_rate;
+    int switch_size;
+    int switching;
+    int switcher_joinable;
+    pthread_t switcher;
+} pipeline;
+
+// a frame copied out of a pipeline
+typedef struct pipeline_frame
+{
+    // MAX_CHANNELS * MAX_BANDS values, count of them set
+    float* values;
+    int count;
+    int spectra;
+
+    // the peaks of the values, like them, NULL to not take them, and 1 if
+    // the analyzer holds peaks
+    float* peaks;
+    int held;
+
+    // frame number, from 1, 0 before the first
+    long long frame;
+
+    int sample_rate;
+    long long read_ns;
+    int queued;
+
+    onset_info onsets;
+} pipeline_frame;
+
+// the capture and analyzer are set up by the caller, before starting
+// returns 1 on failure
+int
+pipeline_init(pipeline* p);
+
+// opens the capture with `source` at a format, before starting
+// returns 1 on failure
+int
+pipeline_open(pipeline* p,
+              const capture_backend* backend,
+              const char* source,
+              int sample_rate,
+              int fft_size);
+
+// returns 1 if the thread could not be started
+int
+pipeline_start(pipeline* p);
+
+// stops and joins the thread and a switch in progress, the capture and
+// analyzer stay open
+void
+pipeline_stop(pipeline* p);
+
+// stops the thread and frees everything, the capture and analyzer too
+void
+pipeline_free(pipeline* p);
+
+void
+pipeline_lock(pipeline* p);
+
+void
+pipeline_unlock(pipeline* p);
+
+// reopens the capture with `source` at a new format, with the lock held
+//
+// the source is opened on a thread of its own and swapped in, along with
+// the analyzer resized to the format, once it delivered its first samples;
+// the current capture runs until then and stays if the new one fails, a
+// newer request replaces one still opening
+//
+// a device that opens only once (alsa hw) fails to open itself again, so
+// a new format of the current source is then opened in place of the
+// current capture, which is reopened at its old format if that fails too
+// returns 1 if the switch could not be started
+int
+pipeline_switch(pipeline* p,
+                const capture_backend* backend,
+                const char* source,
+                int sample_rate,
+                int fft_size);
+
+// waits up to timeout_ns for a frame newer than `seen`
+// returns 1 if none came
+int
+pipeline_wait(pipeline* p, long long seen, long long timeout_ns);
+
+// 1 once the capture ended and every frame was taken
+int
+pipeline_ended(pipeline* p);
+
+// copies the last frame into out, out->values and out->peaks have to
+// hold MAX_CHANNELS * MAX_BANDS values
+void
+pipeline_take(pipeline* p, pipeline_frame* out);
+
+#endif
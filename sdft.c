@@ -0,0 +1,311 @@
+#include "sdft.h"
+#include <math.h>
+#include <stdlib.h>
+
+// bin m of the dft of real samples folded into 0 .. size / 2, the bins
+// past either end are the conjugates of the folded ones
+static int
+fold(int m, int size)
+{
+    if (m < 0)
+        return -m;
+    if (m > size / 2)
+        return size - m;
+    return m;
+}
+
+// the bins a read bin is windowed from, bin 0 is replaced by bin 1 and
+// nyquist like the rfft path does, returns how many
+static int
+centers(int k, int size, int* out)
+{
+    if (k > 0) {
+        out[0] = k;
+        return 1;
+    }
+
+    out[0] = 1;
+    out[1] = size / 2;
+    return 2;
+}
+
+int
+sdft_init(sdft* s, const band_map* map, int size)
+{
+    *s = (sdft){ 0 };
+
+    int half = size / 2;
+    unsigned char* read = calloc(half + 1, 1);
+
+    s->size = size;
+    s->slot = malloc((half + 1) * sizeof(int));
+    s->diff = malloc(size * sizeof(double));
+    s->cos = malloc(size * sizeof(double));
+
+    if (!read || !s->slot || !s->diff || !s->cos) {
+        free(read);
+        sdft_free(s);
+        return 1;
+    }
+
+    for (int b = 0; b < map->count; b++)
+        for (int j = 0; j < map->len[b]; j++)
+            read[map->first[b] + j] = 1;
+
+    // a slot per bin some read bin is windowed from
+    for (int k = 0; k <= half; k++)
+        s->slot[k] = -1;
+
+    int reads = 0;
+    int count = 0;
+
+    for (int k = 0; k <= half; k++) {
+        if (!read[k])
+            continue;
+
+        int c[2];
+        int n = centers(k, size, c);
+
+        for (int i = 0; i < n; i++) {
+            for (int d = -SDFT_TAPS; d <= SDFT_TAPS; d++) {
+                int m = fold(c[i] + d, size);
+                if (s->slot[m] < 0)
+                    s->slot[m] = count++;
+            }
+        }
+
+        reads++;
+    }
+
+    int padded = (count + SDFT_LANES - 1) / SDFT_LANES * SDFT_LANES;
+
+    s->bins = malloc(padded * sizeof(int));
+    s->wr = malloc(padded * sizeof(double));
+    s->wi = malloc(padded * sizeof(double));
+    s->reads = malloc(reads * sizeof(int));
+    s->re = calloc(MAX_CHANNELS * padded, sizeof(double));
+    s->im = calloc(MAX_CHANNELS * padded, sizeof(double));
+
+    if (!s->bins || !s->wr || !s->wi || !s->reads || !s->re || !s->im) {
+        free(read);
+        sdft_free(s);
+        return 1;
+    }
+
+    s->count = count;
+    s->padded = padded;
+
+    // the padding slides at dc and is never read
+    for (int j = count; j < padded; j++)
+        s->bins[j] = 0;
+
+    for (int k = 0; k <= half; k++)
+        if (s->slot[k] >= 0)
+            s->bins[s->slot[k]] = k;
+
+    for (int j = 0; j < padded; j++) {
+        double w = 2 * M_PI * s->bins[j] / size;
+        s->wr[j] = cos(w);
+        s->wi[j] = sin(w);
+    }
+
+    for (int k = 0; k <= half; k++)
+        if (read[k])
+            s->reads[s->read_count++] = k;
+
+    for (int i = 0; i < size; i++)
+        s->cos[i] = cos(2 * M_PI * i / size);
+
+    for (int c = 0; c < MAX_CHANNELS; c++)
+        s->since[c] = (long)SDFT_ANCHOR_WINDOWS * size;
+
+    free(read);
+    return 0;
+}
+
+void
+sdft_free(sdft* s)
+{
+    free(s->bins);
+    free(s->slot);
+    free(s->wr);
+    free(s->wi);
+    free(s->reads);
+    free(s->re);
+    free(s->im);
+    free(s->diff);
+    free(s->cos);
+
+    *s = (sdft){ 0 };
+}
+
+// the bins of spectrum c straight from the dft of the history, in
+// size multiply-adds per bin
+static void
+anchor(sdft* s, int c, const float* history)
+{
+    double* re = s->re + c * s->padded;
+    double* im = s->im + c * s->padded;
+    int mask = s->size - 1;
+    int quarter = s->size / 4;
+
+    for (int j = 0; j < s->padded; j++) {
+        int k = s->bins[j];
+        double r = 0;
+        double i = 0;
+
+        // sin(w) is cos(w - pi / 2), a quarter of the table back
+        for (int n = 0, p = 0; n < s->size; n++, p = (p + k) & mask) {
+            r += history[n] * s->cos[p];
+            i -= history[n] * s->cos[(p - quarter) & mask];
+        }
+
+        re[j] = r;
+        im[j] = i;
+    }
+
+    s->since[c] = 0;
+}
+
+// the bins of one spectrum over n samples of d, SDFT_LANES bins at a time
+// so their state stays in registers, a vector of bins per sample
+static void
+slide(int m,
+      const double* restrict wr,
+      const double* restrict wi,
+      double* restrict re,
+      double* restrict im,
+      const double* restrict d,
+      int n)
+{
+    for (int g = 0; g < m; g += SDFT_LANES) {
+        double a[SDFT_LANES];
+        double b[SDFT_LANES];
+
+        for (int j = 0; j < SDFT_LANES; j++) {
+            a[j] = re[g + j];
+            b[j] = im[g + j];
+        }
+
+        for (int i = 0; i < n; i++) {
+            double v = d[i];
+
+            for (int j = 0; j < SDFT_LANES; j++) {
+                double r = a[j] + v;
+                a[j] = r * wr[g + j] - b[j] * wi[g + j];
+                b[j] = r * wi[g + j] + b[j] * wr[g + j];
+            }
+        }
+
+        for (int j = 0; j < SDFT_LANES; j++) {
+            re[g + j] = a[j];
+            im[g + j] = b[j];
+        }
+    }
+}
+
+void
+sdft_update(sdft* s, int c, const float* history, const float* x, int n)
+{
+    if (s->since[c] >= (long)SDFT_ANCHOR_WINDOWS * s->size)
+        anchor(s, c, history);
+
+    // the sample leaving the window is the i-th oldest one
+    for (int i = 0; i < n; i++)
+        s->diff[i] = (double)x[i] - history[i];
+
+    slide(s->padded,
+          s->wr,
+          s->wi,
+          s->re + c * s->padded,
+          s->im + c * s->padded,
+          s->diff,
+          n);
+
+    s->since[c] += n;
+}
+
+// the window as taps of the neighbouring bins, offset 0 .. SDFT_TAPS on
+// either side, for the tables of stft scaled to a mean of 1
+static void
+window_taps(window_type window, double* taps)
+{
+    taps[0] = 1;
+    taps[1] = 0;
+    taps[2] = 0;
+
+    switch (window) {
+        case WindowHanning:
+            taps[1] = -0.5;
+            break;
+        case WindowHamming:
+            taps[1] = -0.23 / 0.54;
+            break;
+        case WindowBlackman:
+            taps[1] = -0.25 / 0.42;
+            taps[2] = 0.04 / 0.42;
+            break;
+        default:
+            break;
+    }
+}
+
+// bin k of spectrum c windowed by taps
+static void
+windowed(const sdft* s,
+         int c,
+         int k,
+         const double* taps,
+         double* re,
+         double* im)
+{
+    const double* x = s->re + c * s->padded;
+    const double* y = s->im + c * s->padded;
+
+    *re = 0;
+    *im = 0;
+
+    for (int d = -SDFT_TAPS; d <= SDFT_TAPS; d++) {
+        int m = k + d;
+        int j = s->slot[fold(m, s->size)];
+        double t = taps[d < 0 ? -d : d];
+        double sign = m < 0 || m > s->size / 2 ? -1 : 1;
+
+        *re += t * x[j];
+        *im += t * sign * y[j];
+    }
+}
+
+void
+sdft_power(const sdft* s,
+           int c,
+           window_type window,
+           const float* tilt,
+           float* power)
+{
+    double taps[SDFT_TAPS + 1];
+    window_taps(window, taps);
+
+    // scaled by 1 / size like the rfft
+    double scale = 1.0 / s->size;
+
+    for (int r = 0; r < s->read_count; r++) {
+        int k = s->reads[r];
+        double re;
+        double im;
+
+        if (k > 0) {
+            windowed(s, c, k, taps, &re, &im);
+        } else {
+            // remove dc component, the rfft path puts bin 1 in its place
+            // and nyquist in its imaginary part
+            double unused;
+            windowed(s, c, 1, taps, &re, &unused);
+            windowed(s, c, s->size / 2, taps, &im, &unused);
+        }
+
+        float x = (float)(re * scale) * tilt[2 * k];
+        float y = (float)(im * scale) * tilt[2 * k + 1];
+        power[k] = x * x + y * y;
+    }
+}
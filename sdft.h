@@ -0,0 +1,87 @@
+#ifndef SDFT
+#define SDFT
+
+#include "bands.h"
+#include "spectrum.h"
+#include "stft.h"
+
+// bins run side by side, the bank is padded to a multiple of this so the
+// loop over them is whole vectors, twice goertzel's as a rotation is a
+// longer chain per sample and more vectors in flight hide it
+#define SDFT_LANES 16
+
+// neighbours on each side of a bin the windows need, blackman's 3 terms
+// reach 2 bins away
+#define SDFT_TAPS 2
+
+// the bins are recomputed from the history every this many windows of
+// samples, so the rounding of the recurrence cannot build up
+#define SDFT_ANCHOR_WINDOWS 16
+
+// the dft bins a band map reads, slid along one sample at a time
+//
+// each new sample moves every bin in O(1): the sample leaving the window
+// is taken out, the new one added and the bin rotated by its frequency,
+// so a frame costs its hop instead of the whole rfft and the bands can
+// follow the input a few samples at a time. the window is applied to the
+// bins, as a few taps of its neighbours, which the bank tracks as well
+typedef struct sdft
+{
+    // real samples per window
+    int size;
+
+    // tracked bins, padded to a multiple of SDFT_LANES
+    int count;
+    int padded;
+
+    // bin of each tracked slot, the slot of each bin 0 .. size / 2 or -1,
+    // and e^(j 2 pi bin / size) per slot
+    int* bins;
+    int* slot;
+    double* wr;
+    double* wi;
+
+    // the bins the map reads, that get a power
+    int* reads;
+    int read_count;
+
+    // the unwindowed dft of the last size samples, padded values per
+    // spectrum, in double so a window of recurrences keeps its precision
+    double* re;
+    double* im;
+
+    // a hop of new minus leaving samples
+    double* diff;
+
+    // cos(2 pi i / size), for the anchoring
+    double* cos;
+
+    // samples slid per spectrum since it was last anchored
+    long since[MAX_CHANNELS];
+} sdft;
+
+// builds the bank for the bins map reads out of windows of size samples,
+// every spectrum is anchored on its first update
+// returns 1 on failure, leaving the bank empty
+int
+sdft_init(sdft* s, const band_map* map, int size);
+
+void
+sdft_free(sdft* s);
+
+// slides spectrum c over the n samples of x, n <= size, history being the
+// size samples before them, oldest first, like stft's ring + pos before
+// the push
+void
+sdft_update(sdft* s, int c, const float* history, const float* x, int n);
+
+// the tilted power of the bins the map reads in spectrum c windowed by
+// window, like spectrum_power() on the rfft of the windowed history
+void
+sdft_power(const sdft* s,
+           int c,
+           window_type window,
+           const float* tilt,
+           float* power);
+
+#endif
@@ -0,0 +1,203 @@
+// stress test of the shared memory ring, `make shm-test`
+//
+// one writer publishes frames of varying length and spectra as fast as it
+// can while SHM_TEST_READERS threads read them, every field and value of
+// a frame is derived from its index, so a frame read while the writer was
+// in the middle of it shows up as a mismatch
+//
+// usage: shm_test [frames], exits 1 on the first torn or out of order
+// frame
+
+#include "spectrum_shm.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define SHM_TEST_READERS 4
+#define SHM_TEST_SLOTS 4
+#define SHM_TEST_MAX_VALUES 2048
+#define SHM_TEST_FRAMES 200000
+#define SHM_TEST_YIELD 8
+
+typedef struct test_reader
+{
+    pthread_t thread;
+    int id;
+    shm_reader reader;
+
+    // frames read, and checked without a mismatch
+    unsigned long long frames;
+    int failed;
+} test_reader;
+
+static _Atomic int writer_done;
+
+// the spectra of frame i, and its length, a multiple of them
+static int
+frame_spectra(uint64_t i)
+{
+    return 1 + (int)(i & 1);
+}
+
+static int
+frame_count(uint64_t i)
+{
+    int spectra = frame_spectra(i);
+    int bands = SHM_TEST_MAX_VALUES / spectra;
+
+    return spectra * (1 + (int)((i * 7919) % bands));
+}
+
+// value j of frame i, exact in a float
+static float
+frame_value(uint64_t i, int j)
+{
+    return (float)((i * 131 + j) % 65536) / 65536.0f;
+}
+
+// 0 if every field of f matches its frame index
+static int
+check_frame(const shm_frame* f)
+{
+    uint64_t i = f->frame;
+
+    if (f->count != frame_count(i) || f->spectra != frame_spectra(i) ||
+        f->sample_rate != 48000 + (int)(i % 7) ||
+        f->timestamp_ns != (int64_t)i * 1000 ||
+        f->onsets.count != (unsigned int)i ||
+        f->onsets.bpm != (float)(i % 1000) ||
+        f->onsets.last_ns != (long long)i * 3)
+        return 1;
+
+    for (int j = 0; j < f->count; j++)
+        if (f->values[j] != frame_value(i, j))
+            return 1;
+
+    return 0;
+}
+
+static void*
+read_frames(void* arg)
+{
+    test_reader* t = arg;
+    shm_reader* r = &t->reader;
+    shm_frame f;
+    uint64_t last = 0;
+
+    for (;;) {
+        // a done writer has published everything there is
+        int done = writer_done;
+
+        if (shm_reader_next(r, &f)) {
+            if (done)
+                break;
+            sched_yield();
+            continue;
+        }
+
+        if (check_frame(&f) || (t->frames > 0 && f.frame <= last)) {
+            printf("reader %d: frame %llu torn or out of order\n",
+                   t->id,
+                   (unsigned long long)f.frame);
+            t->failed = 1;
+            break;
+        }
+
+        last = f.frame;
+        t->frames++;
+    }
+
+    return NULL;
+}
+
+int
+main(int argc, char** argv)
+{
+    long frames = argc > 1 ? atol(argv[1]) : SHM_TEST_FRAMES;
+
+    char name[64];
+    sprintf(name, "/auvi_shm_test_%d", (int)getpid());
+
+    shm_writer w;
+    if (shm_writer_open(&w, name, SHM_TEST_SLOTS, SHM_TEST_MAX_VALUES)) {
+        printf("could not create %s\n", name);
+        return 1;
+    }
+
+    test_reader readers[SHM_TEST_READERS] = { { 0 } };
+
+    for (int i = 0; i < SHM_TEST_READERS; i++) {
+        readers[i].id = i;
+
+        if (shm_reader_open(&readers[i].reader, name) ||
+            pthread_create(
+              &readers[i].thread, NULL, read_frames, &readers[i])) {
+            printf("could not start reader %d\n", i);
+            shm_writer_close(&w);
+            return 1;
+        }
+    }
+
+    float* values = malloc(SHM_TEST_MAX_VALUES * sizeof(float));
+    if (values == NULL) {
+        shm_writer_close(&w);
+        return 1;
+    }
+
+    for (long i = 0; i < frames; i++) {
+        int count = frame_count(i);
+        for (int j = 0; j < count; j++)
+            values[j] = frame_value(i, j);
+
+        onset_info onsets = { (unsigned int)i, i * 3, (float)(i % 1000) };
+
+        shm_writer_publish(&w,
+                           values,
+                           count,
+                           frame_spectra(i),
+                           48000 + (int)(i % 7),
+                           i * 1000,
+                           &onsets);
+
+        // now and then give the readers a chance to catch up, so they read
+        // frames while the next ones are written instead of only dropping
+        if (i % SHM_TEST_YIELD == 0)
+            sched_yield();
+    }
+
+    writer_done = 1;
+
+    int failed = 0;
+
+    for (int i = 0; i < SHM_TEST_READERS; i++) {
+        test_reader* t = &readers[i];
+        pthread_join(t->thread, NULL);
+
+        // every frame is either read or counted as dropped
+        unsigned long long seen = t->frames + t->reader.dropped;
+        if (!t->failed && seen != (unsigned long long)frames) {
+            printf("reader %d: %llu frames read or dropped of %ld\n",
+                   i,
+                   seen,
+                   frames);
+            t->failed = 1;
+        }
+
+        printf("reader %d: %llu frames, %llu dropped%s\n",
+               i,
+               t->frames,
+               (unsigned long long)t->reader.dropped,
+               t->failed ? ", failed" : "");
+
+        failed |= t->failed;
+        shm_reader_close(&t->reader);
+    }
+
+    free(values);
+    shm_writer_close(&w);
+
+    printf("%s\n", failed ? "failed" : "ok");
+    return failed;
+}
@@ -0,0 +1,247 @@
+#include "spectrum.h"
+#include <string.h>
+
+// spectrum_post() works on blocks of this many bands, small enough for the
+// intermediate levels to stay in l1
+#define POST_BLOCK 256
+
+// partial sums of spectrum_sum(), a vector of floats
+#define SUM_LANES 8
+
+int
+sample_size(sample_format format)
+{
+    switch (format) {
+        case SampleS16:
+            return 2;
+        case SampleF32:
+            return 4;
+        default:
+            return 1;
+    }
+}
+
+const char*
+sample_format_name(sample_format format)
+{
+    switch (format) {
+        case SampleS16:
+            return "s16";
+        case SampleF32:
+            return "f32";
+        default:
+            return "u8";
+    }
+}
+
+void
+spectrum_ingest_u8(float* restrict out,
+                   const unsigned char* restrict in,
+                   int n,
+                   float gain)
+{
+    gain /= 128.0f;
+
+    for (int i = 0; i < n; i++)
+        out[i] = ((int)in[i] - 128) * gain;
+}
+
+void
+spectrum_ingest_s16(float* restrict out,
+                    const short* restrict in,
+                    int n,
+                    float gain)
+{
+    gain /= 32768.0f;
+
+    for (int i = 0; i < n; i++)
+        out[i] = in[i] * gain;
+}
+
+void
+spectrum_ingest_f32(float* restrict out,
+                    const float* restrict in,
+                    int n,
+                    float gain)
+{
+    for (int i = 0; i < n; i++)
+        out[i] = in[i] * gain;
+}
+
+void
+spectrum_split(float* restrict l,
+               float* restrict r,
+               const float* restrict x,
+               int n)
+{
+    for (int i = 0; i < n; i++) {
+        l[i] = x[2 * i];
+        r[i] = x[2 * i + 1];
+    }
+}
+
+void
+spectrum_mix(float* restrict out, const float* restrict x, int n, float side)
+{
+    for (int i = 0; i < n; i++)
+        out[i] = 0.5f * (x[2 * i] + side * x[2 * i + 1]);
+}
+
+void
+spectrum_make_tilt(float* tilt, int n)
+{
+    for (int i = 0; i < n; i++)
+        tilt[i] = 0.04f + (0.5f * (i / (float)n));
+}
+
+// log10 without branches or table lookups, so loops calling it vectorize
+//
+// within 4e-7 of log10 for 1e-3 < x < 1e3
+static inline float
+fast_log10f(float x)
+{
+    // x = m * 2^e with m in [sqrt(1/2), sqrt(2))
+    unsigned int bits;
+    memcpy(&bits, &x, sizeof(bits));
+
+    int e = (int)((bits >> 23) & 0xff) - 127;
+    bits = (bits & 0x007fffff) | 0x3f800000;
+
+    float m;
+    memcpy(&m, &bits, sizeof(m));
+
+    float big = m > 1.41421356f ? 1.0f : 0.0f;
+    m *= 1.0f - 0.5f * big;
+    e += (int)big;
+
+    // log(m) = 2 atanh(s), the series converges fast for |s| < 0.172
+    float s = (m - 1.0f) / (m + 1.0f);
+    float s2 = s * s;
+    float ln_m =
+      2.0f * s *
+      (1.0f +
+       s2 * (1.0f / 3 + s2 * (1.0f / 5 + s2 * (1.0f / 7 + s2 * (1.0f / 9)))));
+
+    return ln_m * 0.43429448f + e * 0.30103000f;
+}
+
+void
+spectrum_power(const float* restrict x,
+               const float* restrict tilt,
+               float* restrict power,
+               int bins)
+{
+    for (int k = 0; k < bins; k++) {
+        float re = x[2 * k] * tilt[2 * k];
+        float im = x[2 * k + 1] * tilt[2 * k + 1];
+        power[k] = re * re + im * im;
+    }
+}
+
+static inline void
+post_compress(float* restrict level, int m)
+{
+    for (int k = 0; k < m; k++) {
+        float mag = __builtin_sqrtf(level[k]);
+
+        // remove noise from low mags, 0 would give log10 = -inf, anything
+        // this small clamps to 0 anyway
+        mag = mag > 1e-20f ? mag : 1e-20f;
+        mag = (0.7f * fast_log10f(1.1f * mag)) + (0.7f * mag);
+
+        // clamp the mag between 0 and 1
+        mag = mag < 0.0f ? 0.0f : mag;
+        mag = mag > 1.0f ? 1.0f : mag;
+
+        level[k] = mag;
+    }
+}
+
+static inline void
+post_ballistics(float* restrict level,
+                float* restrict fft,
+                int m,
+                float attack,
+                float release)
+{
+    for (int k = 0; k < m; k++) {
+        float mag = level[k];
+
+        // move from the last value toward the new one, by the attack
+        // coefficient on the way up and the release one on the way down
+        float prevmag = fft[k];
+        float coef = mag > prevmag ? attack : release;
+        float out = mag + coef * (prevmag - mag);
+
+        // a long silence would decay into denormals, which are slow
+        out = out > 1e-30f ? out : 0.0f;
+
+        fft[k] = out;
+
+        // the rise over the last frame, what the spectral flux sums
+        float rise = mag - prevmag;
+        level[k] = rise > 0.0f ? rise : 0.0f;
+    }
+}
+
+void
+spectrum_post(float* power, float* fft, int n, float attack, float release)
+{
+    // one pass per step over a block vectorizes, one loop doing all of
+    // them does not
+    for (int k = 0; k < n; k += POST_BLOCK) {
+        int m = n - k < POST_BLOCK ? n - k : POST_BLOCK;
+
+        post_compress(power + k, m);
+        post_ballistics(power + k, fft + k, m, attack, release);
+    }
+}
+
+float
+spectrum_sum(const float* restrict x, int n)
+{
+    // a float sum only vectorizes split into as many sums as a vector has
+    // lanes, the order of one running sum is fixed
+    float lanes[SUM_LANES] = { 0 };
+    int k = 0;
+
+    for (; k + SUM_LANES <= n; k += SUM_LANES)
+        for (int j = 0; j < SUM_LANES; j++)
+            lanes[j] += x[k + j];
+
+    float sum = 0;
+    for (; k < n; k++)
+        sum += x[k];
+
+    for (int j = 0; j < SUM_LANES; j++)
+        sum += lanes[j];
+
+    return sum;
+}
+
+void
+spectrum_peaks(const float* restrict fft,
+               float* restrict peaks,
+               float* restrict ages,
+               int n,
+               float dt,
+               float hold,
+               float fall)
+{
+    for (int k = 0; k < n; k++) {
+        float v = fft[k];
+        float peak = peaks[k];
+        float age = ages[k] + dt;
+
+        // a band at or over its peak sets it again, one below it lets it
+        // fall once it was held long enough, down to the band at most
+        int fresh = v >= peak;
+        float fallen = age > hold ? peak - fall : peak;
+
+        peak = fresh ? v : fallen;
+        peak = peak > v ? peak : v;
+
+        peaks[k] = peak;
+        ages[k] = fresh ? 0.0f : age;
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef SPECTRUM
+#define SPECTRUM
+
+// per frame kernels of the analyzer, written as flat loops over restrict
+// pointers so they vectorize
+
+// layouts of the samples handed to the analyzer, frames of 1 or 2
+// interleaved channels
+typedef enum sample_format
+{
+    SampleU8 = 0,
+    SampleS16 = 1,
+    SampleF32 = 2
+} sample_format;
+
+// largest sample, in bytes
+#define MAX_SAMPLE_SIZE 4
+
+// samples per frame, left and right
+#define MAX_CHANNELS 2
+
+int
+sample_size(sample_format format);
+
+const char*
+sample_format_name(sample_format format);
+
+// samples to float, scaled so a full scale signal of any format comes out
+// as +-gain
+
+// (in - 128) * gain / 128
+void
+spectrum_ingest_u8(float* out, const unsigned char* in, int n, float gain);
+
+// in * gain / 32768
+void
+spectrum_ingest_s16(float* out, const short* in, int n, float gain);
+
+// in * gain
+void
+spectrum_ingest_f32(float* out, const float* in, int n, float gain);
+
+// n stereo frames of x to a plane per channel
+void
+spectrum_split(float* l, float* r, const float* x, int n);
+
+// n stereo frames of x to (l + side * r) / 2, the mid with side = 1 and the
+// side with side = -1
+void
+spectrum_mix(float* out, const float* x, int n, float side);
+
+// tilt[i] for the i-th float of an n point rfft output, n values
+//
+// scales down the lower frequencies more than the higher ones to fix
+// spectral leakage a bit
+void
+spectrum_make_tilt(float* tilt, int n);
+
+// tilted power of `bins` complex values of x
+void
+spectrum_power(const float* x, const float* tilt, float* power, int bins);
+
+// the fused post-band stage: for each of n band powers takes the
+// magnitude, compresses it, clamps it to 0..1 and moves the band in fft
+// toward it, keeping `attack` of the difference per frame on the way up
+// and `release` on the way down (0 for an instant one)
+//
+// leaves the rise of each magnitude over the band's last value, 0 for a
+// fall, in power, the terms of the spectral flux
+//
+// all in float, within 1e-6 of the double sqrt / log10 it replaces
+void
+spectrum_post(float* power, float* fft, int n, float attack, float release);
+
+// sum of n values, summed in a fixed order of its own
+float
+spectrum_sum(const float* x, int n);
+
+// peak hold over n bands: a peak follows its band up, stays for `hold`
+// seconds once the band falls below it, then falls by `fall` per frame,
+// never below the band; ages are the seconds since each peak was set and
+// dt the seconds per frame
+void
+spectrum_peaks(const float* fft,
+               float* peaks,
+               float* ages,
+               int n,
+               float dt,
+               float hold,
+               float fall);
+
+#endif
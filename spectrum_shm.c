@@ -0,0 +1,278 @@
+#include "spectrum_shm.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// header and slots start on their own cache lines
+#define SHM_ALIGN 64
+
+// copies of a slot tried before giving up on it, a writer killed in the
+// middle of a frame leaves its seq odd for good
+#define SHM_READ_TRIES 1000
+
+static uint64_t
+align_up(uint64_t n)
+{
+    return (n + SHM_ALIGN - 1) & ~(uint64_t)(SHM_ALIGN - 1);
+}
+
+static uint64_t
+header_size(void)
+{
+    return align_up(sizeof(shm_header));
+}
+
+static shm_slot*
+slot_at(const shm_header* h, uint64_t frame)
+{
+    return (shm_slot*)((char*)h + header_size() +
+                       (frame % h->slots) * h->slot_size);
+}
+
+int
+shm_writer_open(shm_writer* w, const char* name, int slots, int max_values)
+{
+    if (slots < 1 || max_values < 1 || strlen(name) >= sizeof(w->name))
+        return 1;
+
+    uint64_t slot_size =
+      align_up(sizeof(shm_slot) + (uint64_t)max_values * sizeof(float));
+    uint64_t size = header_size() + slots * slot_size;
+
+    // a stale object of an old run may have another layout
+    shm_unlink(name);
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+        return 1;
+
+    if (ftruncate(fd, (off_t)size) < 0) {
+        close(fd);
+        shm_unlink(name);
+        return 1;
+    }
+
+    void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (p == MAP_FAILED) {
+        shm_unlink(name);
+        return 1;
+    }
+
+    // ftruncate zeroed the slots, so every seq starts even
+    shm_header* h = p;
+    h->version = SHM_VERSION;
+    h->slots = slots;
+    h->max_values = max_values;
+    h->slot_size = slot_size;
+    atomic_store_explicit(&h->published, 0, memory_order_relaxed);
+
+    // readers check the magic last, once the layout is in place
+    atomic_thread_fence(memory_order_release);
+    h->magic = SHM_MAGIC;
+
+    strcpy(w->name, name);
+    w->size = size;
+    w->header = h;
+
+    return 0;
+}
+
+void
+shm_writer_publish(shm_writer* w,
+                   const float* values,
+                   int count,
+                   int spectra,
+                   int sample_rate,
+                   long long timestamp_ns,
+                   const onset_info* onsets)
+{
+    shm_header* h = w->header;
+    uint64_t frame = atomic_load_explicit(&h->published, memory_order_relaxed);
+    shm_slot* slot = slot_at(h, frame);
+
+    if (count > (int)h->max_values)
+        count = h->max_values;
+
+    uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+
+    // odd: being written, the fence keeps the data stores after it
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->count = count;
+    slot->sample_rate = sample_rate;
+    slot->spectra = spectra;
+    slot->frame = frame;
+    slot->timestamp_ns = timestamp_ns;
+    slot->onsets = onsets->count;
+    slot->bpm = onsets->bpm;
+    slot->onset_ns = onsets->last_ns;
+    memcpy(slot->values, values, count * sizeof(float));
+
+    atomic_store_explicit(&slot->seq, seq + 2, memory_order_release);
+    atomic_store_explicit(&h->published, frame + 1, memory_order_release);
+}
+
+void
+shm_writer_close(shm_writer* w)
+{
+    if (w->header == NULL)
+        return;
+
+    munmap(w->header, w->size);
+    shm_unlink(w->name);
+    w->header = NULL;
+}
+
+int
+shm_reader_open(shm_reader* r, const char* name)
+{
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return 1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)header_size()) {
+        close(fd);
+        return 1;
+    }
+    off_t size = st.st_size;
+
+    void* p = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (p == MAP_FAILED)
+        return 1;
+
+    const shm_header* h = p;
+    uint32_t magic = h->magic;
+    atomic_thread_fence(memory_order_acquire);
+
+    if (magic != SHM_MAGIC || h->version != SHM_VERSION ||
+        header_size() + h->slots * h->slot_size > (uint64_t)size) {
+        munmap(p, size);
+        return 1;
+    }
+
+    r->values = malloc(h->max_values * sizeof(float));
+    if (!r->values) {
+        munmap(p, size);
+        return 1;
+    }
+
+    r->size = size;
+    r->header = h;
+    r->next = atomic_load_explicit(
+      (_Atomic uint64_t*)&h->published, memory_order_acquire);
+    r->dropped = 0;
+
+    return 0;
+}
+
+// copies frame `frame` out of its slot
+// returns 1 if the slot holds another frame (it was already overwritten)
+// or stayed busy for SHM_READ_TRIES copies
+static int
+read_slot(shm_reader* r, uint64_t frame, shm_frame* out)
+{
+    const shm_slot* slot = slot_at(r->header, frame);
+    _Atomic uint32_t* seq = (_Atomic uint32_t*)&slot->seq;
+
+    for (int i = 0; i < SHM_READ_TRIES; i++) {
+        uint32_t start = atomic_load_explicit(seq, memory_order_acquire);
+        if (start & 1)
+            continue;
+
+        uint64_t slot_frame = slot->frame;
+        int count = slot->count;
+
+        if (count > (int)r->header->max_values)
+            count = r->header->max_values;
+
+        out->frame = slot_frame;
+        out->timestamp_ns = slot->timestamp_ns;
+        out->sample_rate = slot->sample_rate;
+        out->spectra = slot->spectra;
+        out->onsets.count = slot->onsets;
+        out->onsets.bpm = slot->bpm;
+        out->onsets.last_ns = slot->onset_ns;
+        out->count = count;
+        memcpy(r->values, slot->values, count * sizeof(float));
+
+        // the copy has to be done before seq is checked again
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(seq, memory_order_relaxed) != start)
+            continue;
+
+        out->values = r->values;
+        return slot_frame != frame;
+    }
+
+    return 1;
+}
+
+int
+shm_reader_latest(shm_reader* r, shm_frame* out)
+{
+    _Atomic uint64_t* published = (_Atomic uint64_t*)&r->header->published;
+
+    for (;;) {
+        uint64_t n = atomic_load_explicit(published, memory_order_acquire);
+        if (n == 0)
+            return 1;
+
+        if (!read_slot(r, n - 1, out)) {
+            r->next = n;
+            return 0;
+        }
+
+        // lapped between the load and the copy, the newer one will do, but
+        // a slot that stays busy with nothing new published is a dead writer
+        if (atomic_load_explicit(published, memory_order_acquire) == n)
+            return 1;
+    }
+}
+
+int
+shm_reader_next(shm_reader* r, shm_frame* out)
+{
+    _Atomic uint64_t* published = (_Atomic uint64_t*)&r->header->published;
+    uint64_t slots = r->header->slots;
+
+    for (;;) {
+        uint64_t n = atomic_load_explicit(published, memory_order_acquire);
+        if (r->next >= n)
+            return 1;
+
+        if (n - r->next > slots) {
+            r->dropped += n - slots - r->next;
+            r->next = n - slots;
+        }
+
+        if (read_slot(r, r->next, out)) {
+            r->dropped++;
+            r->next++;
+            continue;
+        }
+
+        r->next++;
+        return 0;
+    }
+}
+
+void
+shm_reader_close(shm_reader* r)
+{
+    if (r->header == NULL)
+        return;
+
+    munmap((void*)r->header, r->size);
+    free(r->values);
+    r->header = NULL;
+    r->values = NULL;
+}
@@ -0,0 +1,127 @@
+#ifndef SPECTRUM_SHM
+#define SPECTRUM_SHM
+
+#include "onset.h"
+#include <stdatomic.h>
+#include <stdint.h>
+
+// spectrum frames published into a posix shared memory ring
+//
+// the writer fills slot frame % slots and then bumps `published`, every
+// slot is guarded by a sequence counter that is odd while the slot is
+// being written (a seqlock), so readers never block the writer: they copy
+// a slot and retry if the counter moved while they did
+//
+// the mapping is a shm_header followed by `slots` slots of slot_size
+// bytes, all host endian as only local processes map it
+
+#define SHM_MAGIC 0x4d485341u
+#define SHM_VERSION 3
+#define DEFAULT_SHM_SLOTS 8
+
+typedef struct shm_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slots;
+    uint32_t max_values;
+    uint64_t slot_size;
+
+    // frames published so far, frame i lives in slot i % slots
+    _Atomic uint64_t published;
+} shm_header;
+
+typedef struct shm_slot
+{
+    _Atomic uint32_t seq;
+    // values of all spectra, count / spectra bands each
+    uint32_t count;
+    uint32_t sample_rate;
+    uint32_t spectra;
+    uint64_t frame;
+    int64_t timestamp_ns;
+
+    // onsets so far, a reader sees one wherever the count grew, the
+    // monotonic time of the last one and the tempo, 0 while unknown; with
+    // several devices these are the first device's only
+    uint32_t onsets;
+    float bpm;
+    int64_t onset_ns;
+
+    float values[];
+} shm_slot;
+
+typedef struct shm_writer
+{
+    char name[256];
+    uint64_t size;
+    shm_header* header;
+} shm_writer;
+
+// a frame copied out of the ring, values points into the reader
+typedef struct shm_frame
+{
+    uint64_t frame;
+    int64_t timestamp_ns;
+    int sample_rate;
+    int count;
+    int spectra;
+    onset_info onsets;
+    const float* values;
+} shm_frame;
+
+typedef struct shm_reader
+{
+    uint64_t size;
+    const shm_header* header;
+
+    // the next frame shm_reader_next() returns
+    uint64_t next;
+
+    // frames the writer overwrote before shm_reader_next() got to them
+    uint64_t dropped;
+
+    // max_values floats, what shm_frame.values points to
+    float* values;
+} shm_reader;
+
+// creates (or replaces) the shared memory object `name`, e.g. "/auvi"
+// returns 1 on failure
+int
+shm_writer_open(shm_writer* w, const char* name, int slots, int max_values);
+
+// copies count values (clamped to max_values) of `spectra` spectra, one
+// after the other, into the next slot
+void
+shm_writer_publish(shm_writer* w,
+                   const float* values,
+                   int count,
+                   int spectra,
+                   int sample_rate,
+                   long long timestamp_ns,
+                   const onset_info* onsets);
+
+// unmaps and unlinks the object, mapped readers keep their last frames
+void
+shm_writer_close(shm_writer* w);
+
+// maps an existing ring read only, starting at the latest frame
+// returns 1 on failure
+int
+shm_reader_open(shm_reader* r, const char* name);
+
+// the most recent complete frame
+// returns 1 if nothing was published yet
+int
+shm_reader_latest(shm_reader* r, shm_frame* out);
+
+// the oldest frame not read yet, skipping (and counting in r->dropped) the
+// ones already overwritten
+// returns 1 if there is no new frame
+int
+shm_reader_next(shm_reader* r, shm_frame* out);
+
+void
+shm_reader_close(shm_reader* r);
+
+#endif
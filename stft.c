@@ -0,0 +1,120 @@
+#include "stft.h"
+#include "chuck_fft.h"
+#include <stdlib.h>
+#include <string.h>
+
+const char*
+window_name(window_type type)
+{
+    switch (type) {
+        case WindowHanning:
+            return "hanning";
+        case WindowHamming:
+            return "hamming";
+        case WindowBlackman:
+            return "blackman";
+        default:
+            return "rect";
+    }
+}
+
+static void
+make_window(stft* st)
+{
+    switch (st->window_type) {
+        case WindowHanning:
+            hanning(st->window, st->size);
+            break;
+        case WindowHamming:
+            hamming(st->window, st->size);
+            break;
+        case WindowBlackman:
+            blackman(st->window, st->size);
+            break;
+        default:
+            for (int i = 0; i < st->size; i++)
+                st->window[i] = 1.0f;
+            return;
+    }
+
+    double sum = 0;
+    for (int i = 0; i < st->size; i++)
+        sum += st->window[i];
+
+    float gain = (float)(st->size / sum);
+    for (int i = 0; i < st->size; i++)
+        st->window[i] *= gain;
+}
+
+int
+stft_init(stft* st, int size, window_type type)
+{
+    st->size = size;
+    st->pos = 0;
+    st->window_type = type;
+    st->ring = calloc(size * 2, sizeof(float));
+    st->window = malloc(size * sizeof(float));
+
+    if (!st->ring || !st->window) {
+        stft_free(st);
+        return 1;
+    }
+
+    make_window(st);
+    return 0;
+}
+
+void
+stft_free(stft* st)
+{
+    free(st->ring);
+    free(st->window);
+    st->ring = NULL;
+    st->window = NULL;
+}
+
+void
+stft_set_window(stft* st, window_type type)
+{
+    if (type == st->window_type)
+        return;
+
+    st->window_type = type;
+    make_window(st);
+}
+
+void
+stft_clear(stft* st)
+{
+    memset(st->ring, 0, st->size * 2 * sizeof(float));
+    st->pos = 0;
+}
+
+void
+stft_push(stft* st, const float* samples, int n)
+{
+    // until the end of the ring, then wrapped around to the start
+    int first = st->size - st->pos;
+    if (first > n)
+        first = n;
+
+    memcpy(st->ring + st->pos, samples, first * sizeof(float));
+    memcpy(st->ring + st->pos + st->size, samples, first * sizeof(float));
+
+    if (n > first) {
+        memcpy(st->ring, samples + first, (n - first) * sizeof(float));
+        memcpy(
+          st->ring + st->size, samples + first, (n - first) * sizeof(float));
+    }
+
+    st->pos = (st->pos + n) % st->size;
+}
+
+void
+stft_frame(stft* st, float* out)
+{
+    const float* in = st->ring + st->pos;
+
+    for (int i = 0; i < st->size; i++)
+        out[i] = in[i] * st->window[i];
+}
@@ -0,0 +1,57 @@
+#ifndef STFT
+#define STFT
+
+typedef enum window_type
+{
+    WindowRectangular = 0,
+    WindowHanning = 1,
+    WindowHamming = 2,
+    WindowBlackman = 3
+} window_type;
+
+#define WINDOW_TYPES 4
+
+// sliding analysis window over the captured samples
+typedef struct stft
+{
+    // samples per frame
+    int size;
+
+    // sample history, every sample is written at pos and pos + size so the
+    // last `size` samples are always contiguous at ring + pos
+    float* ring;
+    int pos;
+
+    window_type window_type;
+
+    // window table, scaled to a mean of 1 so tapering keeps the level
+    float* window;
+} stft;
+
+const char*
+window_name(window_type type);
+
+// allocates a silent history, returns 1 on failure
+int
+stft_init(stft* st, int size, window_type type);
+
+void
+stft_free(stft* st);
+
+// recomputes the window table if the type changed
+void
+stft_set_window(stft* st, window_type type);
+
+// back to a silent history
+void
+stft_clear(stft* st);
+
+// appends n samples, n <= size
+void
+stft_push(stft* st, const float* samples, int n);
+
+// writes the windowed last `size` samples to out
+void
+stft_frame(stft* st, float* out);
+
+#endif
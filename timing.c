@@ -0,0 +1,83 @@
+#include "timing.h"
+#include <errno.h>
+#include <time.h>
+
+long long
+time_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+long long
+time_cpu_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (long long)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+void
+time_sleep_until_ns(long long deadline)
+{
+    struct timespec ts;
+    ts.tv_sec = deadline / NS_PER_SEC;
+    ts.tv_nsec = deadline % NS_PER_SEC;
+
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+rate_counter
+rc_init(void)
+{
+    rate_counter rc;
+    rc.window_start = time_now_ns();
+    rc.count = 0;
+    rc.per_sec = 0;
+    return rc;
+}
+
+void
+rc_tick(rate_counter* rc, long long now)
+{
+    rc->count++;
+    rc_roll(rc, now);
+}
+
+void
+rc_roll(rate_counter* rc, long long now)
+{
+    long long elapsed = now - rc->window_start;
+    if (elapsed < NS_PER_SEC)
+        return;
+
+    rc->per_sec = (int)((long long)rc->count * NS_PER_SEC / elapsed);
+    rc->count = 0;
+    rc->window_start = now;
+}
+
+cpu_meter
+cm_init(void)
+{
+    cpu_meter cm;
+    cm.window_start = time_now_ns();
+    cm.cpu_start = time_cpu_ns();
+    cm.ms_per_sec = 0;
+    return cm;
+}
+
+void
+cm_roll(cpu_meter* cm, long long now)
+{
+    long long elapsed = now - cm->window_start;
+    if (elapsed < NS_PER_SEC)
+        return;
+
+    long long cpu = time_cpu_ns();
+
+    cm->ms_per_sec = (double)(cpu - cm->cpu_start) * 1000 / elapsed;
+    cm->cpu_start = cpu;
+    cm->window_start = now;
+}
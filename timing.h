@@ -0,0 +1,57 @@
+#ifndef TIMING
+#define TIMING
+
+#define NS_PER_SEC 1000000000LL
+
+// counts events and reports them per second of monotonic time
+typedef struct rate_counter
+{
+    long long window_start;
+    int count;
+
+    // events counted in the last full second
+    int per_sec;
+} rate_counter;
+
+// process cpu time used per second of monotonic time
+typedef struct cpu_meter
+{
+    long long window_start;
+    long long cpu_start;
+
+    // average over the last full second
+    double ms_per_sec;
+} cpu_meter;
+
+// monotonic clock in nanoseconds
+long long
+time_now_ns(void);
+
+// cpu time of the process, all threads, in nanoseconds
+long long
+time_cpu_ns(void);
+
+// sleeps once until `deadline` (monotonic ns), restarting on signals
+void
+time_sleep_until_ns(long long deadline);
+
+rate_counter
+rc_init(void);
+
+// counts one event
+void
+rc_tick(rate_counter* rc, long long now);
+
+// closes the current window once a second has passed, call it regularly
+// so per_sec also drops when no events happen
+void
+rc_roll(rate_counter* rc, long long now);
+
+cpu_meter
+cm_init(void);
+
+// closes the current window once a second has passed, like rc_roll()
+void
+cm_roll(cpu_meter* cm, long long now);
+
+#endif
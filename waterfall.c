@@ -0,0 +1,123 @@
+#include "waterfall.h"
+#include <stdlib.h>
+
+// the color map, dark blue through red to a pale yellow at full scale
+#define STOPS 5
+
+static const Color stops[STOPS] = {
+    { 0, 0, 0, 255 },     { 30, 20, 110, 255 },   { 180, 40, 90, 255 },
+    { 250, 150, 30, 255 }, { 255, 255, 220, 255 },
+};
+
+void
+waterfall_init(waterfall* w)
+{
+    *w = (waterfall){ 0 };
+
+    for (int i = 0; i < WATERFALL_COLORS; i++) {
+        float x = (float)i / (WATERFALL_COLORS - 1) * (STOPS - 1);
+        int s = x < STOPS - 1 ? (int)x : STOPS - 2;
+        float t = x - s;
+
+        Color a = stops[s];
+        Color b = stops[s + 1];
+
+        w->lut[i] = (Color){
+            (unsigned char)(a.r + (b.r - a.r) * t + 0.5f),
+            (unsigned char)(a.g + (b.g - a.g) * t + 0.5f),
+            (unsigned char)(a.b + (b.b - a.b) * t + 0.5f),
+            255,
+        };
+    }
+}
+
+// a black ring of WATERFALL_ROWS rows of count texels
+static int
+create(waterfall* w, int count)
+{
+    if (count > w->capacity) {
+        Color* row = realloc(w->row, count * sizeof(Color));
+        if (row == NULL)
+            return 1;
+
+        w->row = row;
+        w->capacity = count;
+    }
+
+    if (w->texture.id != 0)
+        UnloadTexture(w->texture);
+
+    Image image = GenImageColor(count, WATERFALL_ROWS, BLACK);
+    w->texture = LoadTextureFromImage(image);
+    UnloadImage(image);
+
+    if (w->texture.id == 0)
+        return 1;
+
+    w->count = count;
+    w->head = 0;
+    return 0;
+}
+
+int
+waterfall_push(waterfall* w, const float* values, int count)
+{
+    if (count != w->count || w->texture.id == 0)
+        if (create(w, count)) {
+            w->count = 0;
+            return 1;
+        }
+
+    for (int i = 0; i < count; i++) {
+        float v = values[i] * (WATERFALL_COLORS - 1) + 0.5f;
+
+        v = v < 0 ? 0 : v;
+        v = v > WATERFALL_COLORS - 1 ? WATERFALL_COLORS - 1 : v;
+
+        w->row[i] = w->lut[(int)v];
+    }
+
+    UpdateTextureRec(
+      w->texture, (Rectangle){ 0, w->head, count, 1 }, w->row);
+
+    w->head = (w->head + 1) % WATERFALL_ROWS;
+    return 0;
+}
+
+void
+waterfall_draw(waterfall* wf, int top, int w, int h)
+{
+    if (wf->texture.id == 0)
+        return;
+
+    // rows head - 1 down to 0 are the newest, then rows - 1 down to head,
+    // a negative source height draws a part upside down
+    float head = wf->head;
+    float count = wf->count;
+    float newer = h * head / WATERFALL_ROWS;
+
+    if (wf->head > 0)
+        DrawTexturePro(wf->texture,
+                       (Rectangle){ 0, 0, count, -head },
+                       (Rectangle){ 0, top, w, newer },
+                       (Vector2){ 0, 0 },
+                       0,
+                       WHITE);
+
+    DrawTexturePro(wf->texture,
+                   (Rectangle){ 0, head, count, -(WATERFALL_ROWS - head) },
+                   (Rectangle){ 0, top + newer, w, h - newer },
+                   (Vector2){ 0, 0 },
+                   0,
+                   WHITE);
+}
+
+void
+waterfall_free(waterfall* w)
+{
+    if (w->texture.id != 0)
+        UnloadTexture(w->texture);
+
+    free(w->row);
+    *w = (waterfall){ 0 };
+}
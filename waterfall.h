@@ -0,0 +1,50 @@
+#ifndef WATERFALL
+#define WATERFALL
+
+#include "raylib.h"
+
+// frames of history the waterfall shows
+#define WATERFALL_ROWS 512
+
+// entries of the color lookup table
+#define WATERFALL_COLORS 256
+
+// the bands over time, newest on top
+//
+// the history lives in a texture of a row per frame used as a ring, each
+// frame uploads one row and the ring is drawn as two quads, so a frame
+// costs the same whatever the history length
+typedef struct waterfall
+{
+    // 0 until the first push
+    Texture2D texture;
+
+    // bands per row, and the row the next frame goes to
+    int count;
+    int head;
+
+    // a row of colors, room for capacity bands
+    Color* row;
+    int capacity;
+
+    // value (0..1) to color, built once
+    Color lut[WATERFALL_COLORS];
+} waterfall;
+
+void
+waterfall_init(waterfall* w);
+
+// adds a row of count values, starting over when the count changed
+// returns 1 if the texture could not be created
+int
+waterfall_push(waterfall* w, const float* values, int count);
+
+// draws the history filling w * h from y = top
+void
+waterfall_draw(waterfall* wf, int top, int w, int h);
+
+// needs the gl context, so before CloseWindow()
+void
+waterfall_free(waterfall* w);
+
+#endif
@@ -0,0 +1,179 @@
+#include "wav.h"
+#include <stdlib.h>
+#include <string.h>
+
+// frames read from the file at a time
+#define WAV_BUF_FRAMES 4096
+
+#define WAVE_FORMAT_PCM 1
+#define WAVE_FORMAT_IEEE_FLOAT 3
+#define WAVE_FORMAT_EXTENSIBLE 0xfffe
+
+static unsigned int
+get_u16(const unsigned char* p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int
+get_u32(const unsigned char* p)
+{
+    return get_u16(p) | (get_u16(p + 2) << 16);
+}
+
+static int
+fail(wav_file* w, const char* path, const char* why)
+{
+    printf("%s: %s\n", path, why);
+    fclose(w->file);
+    w->file = NULL;
+    return 1;
+}
+
+int
+wav_open(wav_file* w, const char* path)
+{
+    unsigned char h[40];
+
+    w->buf = NULL;
+    w->file = fopen(path, "rb");
+    if (!w->file) {
+        printf("could not open %s\n", path);
+        return 1;
+    }
+
+    if (fread(h, 1, 12, w->file) != 12 || memcmp(h, "RIFF", 4) != 0 ||
+        memcmp(h + 8, "WAVE", 4) != 0)
+        return fail(w, path, "not a wav file");
+
+    int tag = -1;
+    int bits = 0;
+    unsigned int data_size;
+    w->channels = 0;
+
+    // walk the chunks up to the data, taking the format on the way
+    for (;;) {
+        if (fread(h, 1, 8, w->file) != 8)
+            return fail(w, path, "no data chunk");
+
+        unsigned int size = get_u32(h + 4);
+
+        if (memcmp(h, "data", 4) == 0) {
+            if (tag < 0)
+                return fail(w, path, "data before the format");
+
+            data_size = size;
+            break;
+        }
+
+        if (memcmp(h, "fmt ", 4) == 0 && size >= 16) {
+            unsigned int n = size < sizeof(h) ? size : sizeof(h);
+            if (fread(h, 1, n, w->file) != n)
+                return fail(w, path, "truncated format");
+
+            tag = get_u16(h);
+            w->channels = get_u16(h + 2);
+            w->sample_rate = get_u32(h + 4);
+            bits = get_u16(h + 14);
+
+            // the sub format guid starts with the plain format tag
+            if (tag == WAVE_FORMAT_EXTENSIBLE && n >= 26)
+                tag = get_u16(h + 24);
+
+            size -= n;
+        }
+
+        // chunks are padded to even sizes
+        if (fseek(w->file, size + (size & 1), SEEK_CUR) != 0)
+            return fail(w, path, "truncated chunk");
+    }
+
+    if (tag == WAVE_FORMAT_PCM && bits == 8)
+        w->format = SampleU8;
+    else if (tag == WAVE_FORMAT_PCM && bits == 16)
+        w->format = SampleS16;
+    else if (tag == WAVE_FORMAT_IEEE_FLOAT && bits == 32)
+        w->format = SampleF32;
+    else
+        return fail(w, path, "unsupported format, use u8, s16 or float32");
+
+    if (w->channels != 1 && w->channels != 2)
+        return fail(w, path, "only mono and stereo are supported");
+
+    w->frames = data_size / (w->channels * sample_size(w->format));
+    w->pos = 0;
+    w->buf_frames = WAV_BUF_FRAMES;
+    w->buf = malloc(WAV_BUF_FRAMES * w->channels * sample_size(w->format));
+    if (!w->buf)
+        return fail(w, path, "out of memory");
+
+    return 0;
+}
+
+// n frames of w->buf to interleaved samples, little endian whatever the
+// host
+static void
+decode(wav_file* w, void* out, int n)
+{
+    const unsigned char* p = w->buf;
+    n *= w->channels;
+
+    switch (w->format) {
+        case SampleU8:
+            memcpy(out, p, n);
+            break;
+        case SampleS16: {
+            short* o = out;
+            for (int i = 0; i < n; i++)
+                o[i] = (short)get_u16(p + 2 * i);
+            break;
+        }
+        case SampleF32: {
+            float* o = out;
+            for (int i = 0; i < n; i++) {
+                unsigned int bits = get_u32(p + 4 * i);
+                memcpy(&o[i], &bits, sizeof(bits));
+            }
+            break;
+        }
+    }
+}
+
+int
+wav_read(wav_file* w, void* out, int frames)
+{
+    int size = sample_size(w->format) * w->channels;
+    int done = 0;
+
+    while (done < frames && w->pos < w->frames) {
+        long long left = w->frames - w->pos;
+        int n = frames - done;
+
+        n = n < w->buf_frames ? n : w->buf_frames;
+        n = n < left ? n : (int)left;
+
+        n = fread(w->buf, size, n, w->file);
+        if (n <= 0) {
+            // truncated file, treat what is missing as the end
+            w->frames = w->pos;
+            break;
+        }
+
+        decode(w, (char*)out + done * size, n);
+        done += n;
+        w->pos += n;
+    }
+
+    return done;
+}
+
+void
+wav_close(wav_file* w)
+{
+    if (w->file)
+        fclose(w->file);
+
+    free(w->buf);
+    w->file = NULL;
+    w->buf = NULL;
+}
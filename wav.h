@@ -0,0 +1,39 @@
+#ifndef WAV
+#define WAV
+
+#include "spectrum.h"
+#include <stdio.h>
+
+// reader of PCM WAV files: u8, s16 or float32, mono or stereo
+//
+// frames are read as interleaved samples in the format of the file
+typedef struct wav_file
+{
+    FILE* file;
+
+    int sample_rate;
+    int channels;
+    sample_format format;
+
+    // frames in the data chunk, and read so far
+    long long frames;
+    long long pos;
+
+    // raw frames of one read
+    unsigned char* buf;
+    int buf_frames;
+} wav_file;
+
+// returns 1 on failure, printing why
+int
+wav_open(wav_file* w, const char* path);
+
+// reads up to `frames` frames of w->channels samples of w->format into out
+// returns the frames read, less than frames at the end of the data
+int
+wav_read(wav_file* w, void* out, int frames);
+
+void
+wav_close(wav_file* w);
+
+#endif